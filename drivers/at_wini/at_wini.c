@@ -20,6 +20,7 @@
 #include <minix/sysutil.h>
 #include <minix/keymap.h>
 #include <sys/ioc_disk.h>
+#include <minix/trace.h>
 
 #define ATAPI_DEBUG	    0	/* To debug ATAPI code. */
 
@@ -238,6 +239,7 @@ PUBLIC int main()
 {
 /* Set special disk parameters then call the generic main loop. */
   init_params();
+  trace_init(TRS_DISK);
   driver_task(&w_dtab);
   return(OK);
 }
@@ -891,6 +893,9 @@ struct command *cmd;		/* Command block */
   pv_set(outbyte[6], base_cmd + REG_COMMAND, cmd->command);
   if ((s=sys_voutb(outbyte,7)) != OK)
   	panic(w_name(),"Couldn't write registers with sys_voutb()",s);
+  TRACE(TEV_DISK_CMD, device_caller, cmd->command,
+  	((long) cmd->ldh << 24) | ((long) cmd->cyl_hi << 16) |
+  	((long) cmd->cyl_lo << 8) | cmd->sector, cmd->count);
   return(OK);
 }
 
@@ -1128,6 +1133,12 @@ message *m;
 {
 	int r, timeout, prev;
 
+	if (m->m_type == NOTIFY_FROM(LOG_PROC_NR)) {
+		/* The mask of trace classes changed. */
+		trace_update();
+		return EDONTREPLY;
+	}
+
 	if (m->m_type != DEV_IOCTL ) {
 		return EINVAL;
 	}
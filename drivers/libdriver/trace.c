@@ -0,0 +1,83 @@
+/* This file collects the trace records of a server or driver and hands them
+ * to the LOG driver in batches. The TRACE() probe, the record format, and the
+ * event numbers are defined in <minix/trace.h>. Drivers link it with the
+ * driver library; FS links the same object.
+ *
+ * The LOG driver notifies the process when the mask of enabled classes
+ * changes, so a probe never has to ask. A process that starts while tracing
+ * is on records from the next change on.
+ *
+ * The entry points into this file are
+ *   trace_init:	tell which source the records of this process are
+ *   trace_put:		record an event; the slow path of the TRACE() probe
+ *   trace_update:	LOG notified a new mask; hand in leftovers and get it
+ */
+
+#include "../drivers.h"
+#include <minix/com.h>
+#include <minix/trace.h>
+
+PUBLIC long trace_mask;				/* classes enabled at LOG */
+PRIVATE int trace_source = -1;			/* TRS_* of this process */
+PRIVATE int has_tsc = -1;			/* CPU has a cycle counter */
+PRIVATE int trace_count;			/* records in the batch */
+PRIVATE struct trace_rec trace_batch[TRACE_BATCH];
+
+/*===========================================================================*
+ *				trace_init				     *
+ *===========================================================================*/
+/* TRS_* source of the records */
+PUBLIC void trace_init(int source)
+{
+  trace_source = source;
+}
+
+/*===========================================================================*
+ *				trace_put				     *
+ *===========================================================================*/
+/* event number */
+/* process the event happened for */
+/* event specific arguments */
+PUBLIC void trace_put(int ev, int proc, long a, long b, long c)
+{
+/* Record an event whose class is enabled. */
+  register struct trace_rec *tr;
+
+  tr = &trace_batch[trace_count++];
+  if (has_tsc) {
+	read_tsc(&tr->tr_tsc_hi, &tr->tr_tsc_lo);
+  } else {
+	tr->tr_tsc_hi = tr->tr_tsc_lo = 0;
+  }
+  tr->tr_event = ev;
+  tr->tr_proc = proc;
+  tr->tr_arg[0] = a;
+  tr->tr_arg[1] = b;
+  tr->tr_arg[2] = c;
+  if (trace_count == TRACE_BATCH) trace_update();
+}
+
+/*===========================================================================*
+ *				trace_update				     *
+ *===========================================================================*/
+PUBLIC void trace_update()
+{
+/* Hand the batch to the LOG driver. The reply tells the current mask. This
+ * is done when the batch is full, and when LOG notifies a change of the mask.
+ */
+  message m;
+  struct machine machine;
+
+  if (trace_source < 0) return;
+  if (has_tsc < 0) {
+	has_tsc = (sys_getmachine(&machine) == OK && machine.processor > 486);
+  }
+
+  m.m_type = TRACE_EVENTS;
+  m.TRACE_SOURCE = trace_source;
+  m.TRACE_BUF = (char *) trace_batch;
+  m.TRACE_COUNT = trace_count;
+  if (_sendrec(LOG_PROC_NR, &m) == OK && m.REP_STATUS >= 0)
+	trace_mask = m.REP_STATUS;
+  trace_count = 0;
+}
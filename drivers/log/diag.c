@@ -23,10 +23,10 @@ PUBLIC int do_new_kmess(message *m)
 {
 /* Notification for a new kernel message. */
   struct kmessages kmess;		/* entire kmess structure */
-  char print_buf[KMESS_BUF_SIZE];	/* copy new message here */
-  static int prev_next = 0;
-  int bytes;
-  int i, r;
+  char print_buf[KMESS_BUF_SIZE+1];	/* copy new message here */
+  static unsigned prev_next = 0;
+  unsigned bytes, r;
+  int i;
 
   /* Try to get a fresh copy of the buffer with kernel messages. */
   if ((r=sys_getkmessages(&kmess)) != OK) {
@@ -34,18 +34,23 @@ PUBLIC int do_new_kmess(message *m)
   	return EDONTREPLY;
   }
 
-  /* Print only the new part. Determine how many new bytes there are with 
-   * help of the current and previous 'next' index. Note that the kernel
-   * buffer is circular. This works fine if less then KMESS_BUF_SIZE bytes
-   * is new data; else we miss % KMESS_BUF_SIZE here.  
+  /* Print only the new part. The kernel's 'next' field is a free running
+   * sequence number, so the number of new bytes is simply the difference
+   * with the previous value. If that exceeds KMESS_BUF_SIZE, the kernel
+   * overwrote messages before we could fetch them; say so in the log, so
+   * that readers know the output is incomplete.
    * Check for size being positive, the buffer might as well be emptied!
    */
   if (kmess.km_size > 0) {
-      bytes = ((kmess.km_next + KMESS_BUF_SIZE) - prev_next) % KMESS_BUF_SIZE;
-      r=prev_next;				/* start at previous old */ 
+      bytes = kmess.km_next - prev_next;
+      if (bytes > KMESS_BUF_SIZE) {
+          log_dropped(bytes - KMESS_BUF_SIZE);
+          bytes = KMESS_BUF_SIZE;
+      }
+      r = kmess.km_next - bytes;		/* start at oldest new byte */
       i=0;
       while (bytes > 0) {			
-          print_buf[i] = kmess.km_buf[(r%KMESS_BUF_SIZE)];
+          print_buf[i] = kmess.km_buf[r & (KMESS_BUF_SIZE-1)];
           bytes --;
           r ++;
           i ++;
@@ -75,11 +80,6 @@ PUBLIC int do_diagnostics(message *m)
  */
   int result;
   int proc_nr; 
-  vir_bytes src;
-  int count;
-  char c;
-  int i = 0;
-  static char diagbuf[10240];
 
   /* Forward the message to the TTY driver. Inform the TTY driver about the
    * original sender, so that it knows where the buffer to be printed is.
@@ -90,18 +90,10 @@ PUBLIC int do_diagnostics(message *m)
   result = _sendrec(TTY_PROC_NR, m);
 
   /* Now also make a copy for the private buffer at the LOG server, so
-   * that the messages can be reviewed at a later time.
+   * that the messages can be reviewed at a later time. The whole buffer
+   * is copied straight into the log; errors are ignored.
    */
-  src = (vir_bytes) m->DIAG_PRINT_BUF;
-  count = m->DIAG_BUF_COUNT; 
-  while (count > 0 && i < sizeof(diagbuf)-1) {
-      if (sys_datacopy(proc_nr, src, SELF, (vir_bytes) &c, 1) != OK) 
-          break;		/* stop copying on error */
-      src ++;
-      count --;
-      diagbuf[i++] = c;
-  }
-  log_append(diagbuf, i);
+  log_copy(proc_nr, (vir_bytes) m->DIAG_PRINT_BUF, m->DIAG_BUF_COUNT);
 
   return result;
 }
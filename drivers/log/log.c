@@ -1,5 +1,11 @@
 /* This file contains a driver for:
  *     /dev/klog	- system log device
+ *     /dev/trace	- binary event trace, see trace.c
+ *
+ * The log is a ring buffer addressed by free running sequence numbers.
+ * Writers never wait; they simply overwrite the oldest data. Every reading
+ * process has its own cursor, so several readers each see the whole log,
+ * and a reader that fell too far behind is told how many bytes it lost.
  *
  * Changes:
  *   21 July 2005   - Support for diagnostic messages (Jorrit N. Herder)
@@ -14,12 +20,12 @@
 
 #define LOG_DEBUG		0	/* enable/ disable debugging */
 
-#define NR_DEVS            	1	/* number of minor devices */
+#define NR_DEVS            	2	/* number of minor devices */
+#define NR_LOGS            	1	/* minor devices with a log ring */
 #define MINOR_KLOG		0	/* /dev/klog */
+#define MINOR_TRACE		1	/* /dev/trace */
 
-#define LOGINC(n, i)	do { (n) = (((n) + (i)) % LOG_SIZE); } while(0)
-
-PUBLIC struct logdevice logdevices[NR_DEVS];
+PUBLIC struct logdevice logdevices[NR_LOGS];
 PRIVATE struct device log_geom[NR_DEVS];  	/* base and size of devices */
 PRIVATE int log_device = -1;	 		/* current device */
 
@@ -28,18 +34,24 @@ FORWARD _PROTOTYPE( struct device *log_prepare, (int device) );
 FORWARD _PROTOTYPE( int log_transfer, (int proc_nr, int opcode, off_t position,
 					iovec_t *iov, unsigned nr_req) );
 FORWARD _PROTOTYPE( int log_do_open, (struct driver *dp, message *m_ptr) );
+FORWARD _PROTOTYPE( int log_close, (struct driver *dp, message *m_ptr) );
 FORWARD _PROTOTYPE( int log_cancel, (struct driver *dp, message *m_ptr) );
 FORWARD _PROTOTYPE( int log_select, (struct driver *dp, message *m_ptr) );
 FORWARD _PROTOTYPE( void log_signal, (struct driver *dp, message *m_ptr) );
 FORWARD _PROTOTYPE( int log_other, (struct driver *dp, message *m_ptr) );
 FORWARD _PROTOTYPE( void log_geometry, (struct partition *entry) );
-FORWARD _PROTOTYPE( int subread, (struct logdevice *log, int count, int proc_nr, vir_bytes user_vir) );
+FORWARD _PROTOTYPE( int subread, (struct logdevice *log, struct logreader *lr,
+				int count, int proc_nr, vir_bytes user_vir) );
+FORWARD _PROTOTYPE( struct logreader *find_reader, (struct logdevice *log,
+				int proc_nr) );
+FORWARD _PROTOTYPE( int log_readable, (struct logdevice *log, int proc_nr) );
+FORWARD _PROTOTYPE( int lost_note, (char *buf, unsigned long bytes) );
 
 /* Entry points to this driver. */
 PRIVATE struct driver log_dtab = {
   log_name,	/* current device's name */
   log_do_open,	/* open or mount */
-  do_nop,	/* nothing on a close */
+  log_close,	/* forget the reader's cursor */
   do_nop,	/* ioctl nop */
   log_prepare,	/* prepare for I/O on a given minor device */
   log_transfer,	/* do the I/O */
@@ -60,17 +72,21 @@ extern int device_caller;
  *===========================================================================*/
 PUBLIC int main(void)
 {
-  int i;
-  for(i = 0; i < NR_DEVS; i++) {
+  int i, j;
+  for(i = 0; i < NR_LOGS; i++) {
   	log_geom[i].dv_size = cvul64(LOG_SIZE);
  	log_geom[i].dv_base = cvul64((long)logdevices[i].log_buffer);
- 	logdevices[i].log_size = logdevices[i].log_read =
-	 	logdevices[i].log_write =
-	 	logdevices[i].log_select_alerted =
+ 	logdevices[i].log_seq = logdevices[i].log_clock = 0;
+ 	logdevices[i].log_select_alerted =
 	 	logdevices[i].log_selected =
 	 	logdevices[i].log_select_ready_ops = 0;
- 	logdevices[i].log_proc_nr = 0;
- 	logdevices[i].log_revive_alerted = 0;
+	logdevices[i].log_select_reader = NONE;
+	for(j = 0; j < NR_LOG_READERS; j++) {
+		logdevices[i].log_reader[j].lr_proc_nr = NONE;
+		logdevices[i].log_reader[j].lr_used = 0;
+		logdevices[i].log_reader[j].lr_suspended = 0;
+		logdevices[i].log_reader[j].lr_revive_alerted = 0;
+	}
   }
   driver_task(&log_dtab);
   return(OK);
@@ -106,48 +122,64 @@ PRIVATE int
 subwrite(struct logdevice *log, int count, int proc_nr, vir_bytes user_vir)
 {
 	char *buf;
-	int r;
-	if (log->log_write + count > LOG_SIZE)
-		count = LOG_SIZE - log->log_write;
-	buf = log->log_buffer + log->log_write;
+	unsigned pos, chunk;
+	int r, total;
+	struct logreader *lr;
+
+	if (count < 1) return 0;
+	total = count;
+
+	/* Only the last LOG_SIZE bytes of a huge write can be kept. */
+	if (count > LOG_SIZE) {
+		user_vir += count - LOG_SIZE;
+		log->log_seq += count - LOG_SIZE;
+		count = LOG_SIZE;
+	}
 
-	if(proc_nr == SELF) {
-		memcpy(buf, (char *) user_vir, count);
+	/* Copy the data in at most two pieces, wrapping around the end of
+	 * the ring. Whatever it overwrites is lost for slow readers; they
+	 * find out from their cursor when they read next.
+	 */
+	while (count > 0) {
+		pos = log->log_seq & LOG_MASK;
+		chunk = LOG_SIZE - pos;
+		if (chunk > count) chunk = count;
+		buf = log->log_buffer + pos;
+
+		if(proc_nr == SELF) {
+			memcpy(buf, (char *) user_vir, chunk);
+		}
+		else {
+			if((r=sys_vircopy(proc_nr,D,user_vir,
+					SELF,D,(vir_bytes)buf, chunk)) != OK)
+				return r;
+		}
+		log->log_seq += chunk;
+		user_vir += chunk;
+		count -= chunk;
 	}
-	else {
-		if((r=sys_vircopy(proc_nr,D,user_vir, SELF,D,(int)buf, count)) != OK)
-			return r;
+
+	for (lr = log->log_reader; lr < log->log_reader+NR_LOG_READERS; lr++) {
+        	if(lr->lr_suspended && !lr->lr_revive_alerted) {
+        		/* Someone who was suspended on read can now
+        		 * be revived.
+        		 */
+    			lr->lr_status = subread(log, lr, lr->lr_iosize,
+    				lr->lr_proc_nr, lr->lr_user_vir);
+    			notify(lr->lr_source); 
+    			lr->lr_revive_alerted = 1;
+ 		} 
 	}
 
-	LOGINC(log->log_write, count);
-	log->log_size += count;
-
-        if(log->log_size > LOG_SIZE) {
-        	int overflow;
-        	overflow = log->log_size - LOG_SIZE;
-        	log->log_size -= overflow;
-        	LOGINC(log->log_read, overflow);
-        }
-
-        if(log->log_size > 0 && log->log_proc_nr && !log->log_revive_alerted) {
-        	/* Someone who was suspended on read can now
-        	 * be revived.
-        	 */
-    		log->log_status = subread(log, log->log_iosize,
-    			log->log_proc_nr, log->log_user_vir);
-    		notify(log->log_source); 
-    		log->log_revive_alerted = 1;
- 	} 
-
-	if(log->log_size > 0)
+	if(log_readable(log, log->log_select_reader))
 		log->log_select_ready_ops |= SEL_RD;
 
-	if(log->log_size > 0 && log->log_selected &&
+	if(log_readable(log, log->log_select_reader) && log->log_selected &&
 	  !(log->log_select_alerted)) {
   		/* Someone(s) who was/were select()ing can now
   		 * be awoken. If there was a blocking read (above),
   		 * this can only happen if the blocking read didn't
-  		 * swallow all the data (log_size > 0).
+  		 * swallow all the data.
   		 */
   		if(log->log_selected & SEL_RD) {
     			notify(log->log_select_proc);
@@ -158,7 +190,7 @@ subwrite(struct logdevice *log, int count, int proc_nr, vir_bytes user_vir)
   		}
   	}
 
-        return count;
+        return total;
 }
 
 /*===========================================================================*
@@ -167,40 +199,146 @@ subwrite(struct logdevice *log, int count, int proc_nr, vir_bytes user_vir)
 PUBLIC void
 log_append(char *buf, int count)
 {
-	int w = 0, skip = 0;
+	subwrite(&logdevices[0], count, SELF, (vir_bytes) buf);
+}
+
+/*===========================================================================*
+ *				log_copy				*
+ *===========================================================================*/
+PUBLIC int
+log_copy(int proc_nr, vir_bytes user_vir, int count)
+{
+/* Append a buffer of another process to the log in one go. */
+	return subwrite(&logdevices[0], count, proc_nr, user_vir);
+}
 
-	if(count < 1) return;
-	if(count > LOG_SIZE) skip = count - LOG_SIZE;
-	count -= skip;
-	buf += skip;
-	w = subwrite(&logdevices[0], count, SELF, (vir_bytes) buf);
+/*===========================================================================*
+ *				log_dropped				*
+ *===========================================================================*/
+PUBLIC void
+log_dropped(unsigned long bytes)
+{
+/* Note in the log that data was lost before it reached us. */
+	char note[40];
 
-	if(w > 0 && w < count)
-		subwrite(&logdevices[0], count-w, SELF, (vir_bytes) buf+w);
-	return;
+	log_append(note, lost_note(note, bytes));
 }
 
 /*===========================================================================*
- *				subread					     *
+ *				lost_note				*
  *===========================================================================*/
 PRIVATE int
-subread(struct logdevice *log, int count, int proc_nr, vir_bytes user_vir)
+lost_note(char *buf, unsigned long bytes)
 {
-	char *buf;
-	int r;
-    	if (count > log->log_size)
-    		count = log->log_size;
-        if (log->log_read + count > LOG_SIZE)
-        	count = LOG_SIZE - log->log_read;
+/* Format a line telling that a number of bytes were lost. */
+	static char text[] = " bytes of log lost]\n";
+	char digits[12];
+	int n = 0, i = 0;
+
+	buf[n++] = '[';
+	do { digits[i++] = '0' + bytes % 10; } while ((bytes /= 10) > 0);
+	while (i > 0) buf[n++] = digits[--i];
+	memcpy(buf + n, text, sizeof(text) - 1);
+	return n + sizeof(text) - 1;
+}
+
+/*===========================================================================*
+ *				find_reader				*
+ *===========================================================================*/
+PRIVATE struct logreader *
+find_reader(struct logdevice *log, int proc_nr)
+{
+/* Find the read cursor of a process, or hand out a new one. A new reader
+ * starts at the oldest byte still in the log. If all slots are taken, the
+ * least recently used reader that is not blocked on a read is recycled.
+ */
+	struct logreader *lr, *victim = NULL;
+
+	for (lr = log->log_reader; lr < log->log_reader+NR_LOG_READERS; lr++) {
+		if (lr->lr_proc_nr == proc_nr) {
+			lr->lr_used = ++log->log_clock;
+			return lr;
+		}
+		if (lr->lr_suspended) continue;
+		if (victim == NULL || lr->lr_used < victim->lr_used)
+			victim = lr;
+	}
+	if (victim == NULL) return NULL;
+
+	victim->lr_proc_nr = proc_nr;
+	victim->lr_seq = log->log_seq > LOG_SIZE ? log->log_seq - LOG_SIZE : 0;
+	victim->lr_used = ++log->log_clock;
+	victim->lr_suspended = victim->lr_revive_alerted = 0;
+	return victim;
+}
+
+/*===========================================================================*
+ *				log_readable				*
+ *===========================================================================*/
+PRIVATE int
+log_readable(struct logdevice *log, int proc_nr)
+{
+/* Tell whether a read by a process would find data: if its cursor is behind,
+ * or if it has none yet and there is data, since a new reader starts at the
+ * oldest byte in the log.
+ */
+	struct logreader *lr;
 
-    	buf = log->log_buffer + log->log_read;
-        if((r=sys_vircopy(SELF,D,(int)buf,proc_nr,D,user_vir, count)) != OK)
-        	return r;
+	for (lr = log->log_reader; lr < log->log_reader+NR_LOG_READERS; lr++) {
+		if (lr->lr_proc_nr == proc_nr)
+			return(lr->lr_seq != log->log_seq);
+	}
+	return(log->log_seq != 0);
+}
+
+/*===========================================================================*
+ *				subread					     *
+ *===========================================================================*/
+PRIVATE int
+subread(struct logdevice *log, struct logreader *lr, int count, int proc_nr,
+	vir_bytes user_vir)
+{
+	char *buf, note[40];
+	unsigned long avail;
+	unsigned pos, chunk;
+	int r, n, total = 0;
+
+	/* A reader more than LOG_SIZE bytes behind lost the oldest part of
+	 * what it should have seen. Move its cursor up to the oldest byte
+	 * still in the ring and start the batch with a note saying so.
+	 */
+	if ((avail = log->log_seq - lr->lr_seq) > LOG_SIZE) {
+		n = lost_note(note, avail - LOG_SIZE);
+		lr->lr_seq = log->log_seq - LOG_SIZE;
+		avail = LOG_SIZE;
+		if (n <= count) {
+			if((r=sys_vircopy(SELF,D,(vir_bytes)note,
+					proc_nr,D,user_vir, n)) != OK)
+				return r;
+			user_vir += n;
+			count -= n;
+			total += n;
+		}
+	}
 
-  	LOGINC(log->log_read, count);
-        log->log_size -= count;
+	/* Hand out as much as fits in one batch, even if it wraps. */
+    	if (count > avail)
+    		count = avail;
+	while (count > 0) {
+		pos = lr->lr_seq & LOG_MASK;
+		chunk = LOG_SIZE - pos;
+		if (chunk > count) chunk = count;
+    		buf = log->log_buffer + pos;
+        	if((r=sys_vircopy(SELF,D,(vir_bytes)buf,
+        			proc_nr,D,user_vir, chunk)) != OK)
+        		return r;
+		lr->lr_seq += chunk;
+		user_vir += chunk;
+		count -= chunk;
+		total += chunk;
+	}
 
-        return count;
+        return total;
 }
 
 /*===========================================================================*
@@ -219,7 +357,9 @@ PRIVATE int log_transfer(int proc_nr, int opcode, off_t position, iovec_t *iov,
   struct device *dv;
   unsigned long dv_size;
   int accumulated_read = 0;
+  int r;
   struct logdevice *log;
+  struct logreader *lr;
 
   if(log_device < 0 || log_device >= NR_DEVS)
   	return EIO;
@@ -227,7 +367,7 @@ PRIVATE int log_transfer(int proc_nr, int opcode, off_t position, iovec_t *iov,
   /* Get minor device number and check for /dev/null. */
   dv = &log_geom[log_device];
   dv_size = cv64ul(dv->dv_size);
-  log = &logdevices[log_device];
+  log = log_device < NR_LOGS ? &logdevices[log_device] : NULL;
 
   while (nr_req > 0) {
 	/* How much to transfer and where to / from. */
@@ -238,41 +378,54 @@ PRIVATE int log_transfer(int proc_nr, int opcode, off_t position, iovec_t *iov,
 
 	case MINOR_KLOG:
 	    if (opcode == DEV_GATHER) {
-	    	if (log->log_proc_nr || count < 1) {
-	    		/* There's already someone hanging to read, or
-	    		 * no real I/O requested.
-	    		 */
+	    	if (count < 1) return(OK);	/* no real I/O requested */
+	    	if ((lr = find_reader(log, proc_nr)) == NULL)
+	    		return(accumulated_read ? OK : EAGAIN);
+	    	if (lr->lr_suspended) {
+	    		/* This process already hangs on a read. */
 	    		return(OK);
 	    	}
 
-	    	if (!log->log_size) {
+	    	if (lr->lr_seq == log->log_seq) {
 	    		if(accumulated_read)
 	    			return OK;
 	    		/* No data available; let caller block. */
-	    		log->log_proc_nr = proc_nr;
-	    		log->log_iosize = count;
-	    		log->log_user_vir = user_vir;
-	    		log->log_revive_alerted = 0;
+	    		lr->lr_suspended = 1;
+	    		lr->lr_iosize = count;
+	    		lr->lr_user_vir = user_vir;
+	    		lr->lr_revive_alerted = 0;
 
 			/* Device_caller is a global in drivers library. */
-	    		log->log_source = device_caller;
+	    		lr->lr_source = device_caller;
 #if LOG_DEBUG
 	    		printf("blocked %d (%d)\n", 
-	    			log->log_source, log->log_proc_nr);
+	    			lr->lr_source, lr->lr_proc_nr);
 #endif
 	    		return(SUSPEND);
 	    	}
-	    	count = subread(log, count, proc_nr, user_vir);
-	    	if(count < 0) {
-	    		return count;
-	    	}
+	    	if ((r = subread(log, lr, count, proc_nr, user_vir)) < 0)
+	    		return r;
+	    	count = r;
 	    	accumulated_read += count;
 	    } else {
-	    	count = subwrite(log, count, proc_nr, user_vir);
-	    	if(count < 0)
-	    		return count;
+	    	if ((r = subwrite(log, count, proc_nr, user_vir)) < 0)
+	    		return r;
+	    	count = r;
+	    }
+	    break;
+
+	case MINOR_TRACE:
+	    /* Trace reads never block; they stop when nothing is new. */
+	    if (opcode == DEV_GATHER) {
+	    	if ((r = trace_read(proc_nr, user_vir, count)) <= 0)
+	    		return(r < 0 ? r : OK);
+	    } else {
+	    	if ((r = trace_write(proc_nr, user_vir, count)) < 0)
+	    		return r;
 	    }
+	    count = r;
 	    break;
+
 	/* Unknown (illegal) minor device. */
 	default:
 	    return(EINVAL);
@@ -294,6 +447,31 @@ PRIVATE int log_do_open(struct driver *dp, message *m_ptr)
   return(OK);
 }
 
+/*============================================================================*
+ *				log_close				      *
+ *============================================================================*/
+PRIVATE int log_close(struct driver *dp, message *m_ptr)
+{
+/* Free the read cursor of the closing process, so that its slot can be used
+ * by another reader. FS closes the device for the process that closes its
+ * last descriptor, or that exits. A reader that is still blocked keeps its
+ * cursor; FS cancels the read before it closes for an exiting process.
+ */
+  struct logreader *lr;
+  struct logdevice *log;
+
+  if (log_prepare(m_ptr->DEVICE) == NIL_DEV) return(ENXIO);
+  if (log_device >= NR_LOGS) return(OK);
+  log = &logdevices[log_device];
+  for (lr = log->log_reader; lr < log->log_reader+NR_LOG_READERS; lr++) {
+  	if (lr->lr_proc_nr == m_ptr->PROC_NR && !lr->lr_suspended) {
+  		lr->lr_proc_nr = NONE;
+  		lr->lr_used = 0;
+  	}
+  }
+  return(OK);
+}
+
 /*============================================================================*
  *				log_geometry				      *
  *============================================================================*/
@@ -312,11 +490,19 @@ PRIVATE void log_geometry(struct partition *entry)
 PRIVATE int log_cancel(struct driver *dp, message *m_ptr)
 {
   int d;
+  struct logreader *lr;
   d = m_ptr->TTY_LINE;
   if(d < 0 || d >= NR_DEVS)
   	return EINVAL;
-  logdevices[d].log_proc_nr = 0;
-  logdevices[d].log_revive_alerted = 0;
+  if(d >= NR_LOGS)
+  	return(OK);
+  for (lr = logdevices[d].log_reader;
+       lr < logdevices[d].log_reader+NR_LOG_READERS; lr++) {
+  	if (lr->lr_proc_nr == m_ptr->PROC_NR) {
+  		lr->lr_suspended = 0;
+  		lr->lr_revive_alerted = 0;
+  	}
+  }
   return(OK);
 }
 
@@ -327,6 +513,7 @@ PRIVATE void do_status(message *m_ptr)
 {
 	int d; 
 	message m;
+	struct logreader *lr;
 
 	/* Caller has requested pending status information, which currently
 	 * can be pending available select()s, or REVIVE events. One message
@@ -334,21 +521,24 @@ PRIVATE void do_status(message *m_ptr)
 	 * are to be returned.
 	 */
 
-	for(d = 0; d < NR_DEVS; d++) {
-		/* Check for revive callback. */
-		if(logdevices[d].log_proc_nr && logdevices[d].log_revive_alerted
-		   && logdevices[d].log_source == m_ptr->m_source) {
-			m.m_type = DEV_REVIVE;
-			m.REP_PROC_NR = logdevices[d].log_proc_nr;
-			m.REP_STATUS  = logdevices[d].log_status;
-  			send(m_ptr->m_source, &m);
-			logdevices[d].log_proc_nr = 0;
-			logdevices[d].log_revive_alerted = 0;
+	for(d = 0; d < NR_LOGS; d++) {
+		/* Check for revive callbacks, one reader at a time. */
+		for (lr = logdevices[d].log_reader;
+		     lr < logdevices[d].log_reader+NR_LOG_READERS; lr++) {
+			if(lr->lr_suspended && lr->lr_revive_alerted
+			   && lr->lr_source == m_ptr->m_source) {
+				m.m_type = DEV_REVIVE;
+				m.REP_PROC_NR = lr->lr_proc_nr;
+				m.REP_STATUS  = lr->lr_status;
+  				send(m_ptr->m_source, &m);
+				lr->lr_suspended = 0;
+				lr->lr_revive_alerted = 0;
 #if LOG_DEBUG
-    		printf("revived %d with %d bytes\n", 
-			m.REP_PROC_NR, m.REP_STATUS);
+    			printf("revived %d with %d bytes\n", 
+				m.REP_PROC_NR, m.REP_STATUS);
 #endif
-			return;
+				return;
+			}
 		}
 
 		/* Check for select callback. */
@@ -404,6 +594,10 @@ PRIVATE int log_other(struct driver *dp, message *m_ptr)
 		r = do_diagnostics(m_ptr);
 		break;
 	}
+	case TRACE_EVENTS: {
+		r = do_trace_events(m_ptr);
+		break;
+	}
 	case DEV_STATUS: {
 		do_status(m_ptr);
 		r = EDONTREPLY;
@@ -432,10 +626,15 @@ PRIVATE int log_select(struct driver *dp, message *m_ptr)
 
   ops = m_ptr->PROC_NR & (SEL_RD|SEL_WR|SEL_ERR);
 
-  	/* Read blocks when there is no log. */
-  if((m_ptr->PROC_NR & SEL_RD) && logdevices[d].log_size > 0) {
+  	/* The trace device never blocks. */
+  if(d >= NR_LOGS) return(ops & (SEL_RD|SEL_WR));
+
+  	/* Read blocks when the selecting process has read all there is;
+  	 * FS tells which process that is in COUNT.
+  	 */
+  if((m_ptr->PROC_NR & SEL_RD) && log_readable(&logdevices[d], m_ptr->COUNT)) {
 #if LOG_DEBUG
-  	printf("log can read; size %d\n", logdevices[d].log_size);
+  	printf("log can read; seq %lu\n", logdevices[d].log_seq);
 #endif
   	ready_ops |= SEL_RD; /* writes never block */
  }
@@ -450,6 +649,7 @@ PRIVATE int log_select(struct driver *dp, message *m_ptr)
   if((m_ptr->PROC_NR & SEL_NOTIFY) && ops && !ready_ops) {
   	logdevices[d].log_selected |= ops;
   	logdevices[d].log_select_proc = m_ptr->m_source;
+  	logdevices[d].log_select_reader = m_ptr->COUNT;
 #if LOG_DEBUG
   	printf("log setting selector.\n");
 #endif
@@ -9,24 +9,38 @@
 
 /* Constants and types. */
 
-#define LOG_SIZE	(50*1024) 
+/* The log is a ring of LOG_SIZE bytes. Its size can be changed freely, but
+ * must be a power of two: positions in the log are free running sequence
+ * numbers that are masked to find the buffer index. A reader whose cursor
+ * has fallen more than LOG_SIZE bytes behind has lost data.
+ */
+#define LOG_SIZE	(64*1024) 
+#define LOG_MASK	(LOG_SIZE-1)
+#define NR_LOG_READERS	8	/* processes with their own read cursor */
 #define SUSPENDABLE 	      1
 
-struct logdevice {
-	char log_buffer[LOG_SIZE];
-	int	log_size,	/* no. of bytes in log buffer */
-		log_read,	/* read mark */
-		log_write;	/* write mark */
+struct logreader {
+	int	lr_proc_nr;	/* reading process, or NONE if slot free */
+	unsigned long lr_seq;	/* sequence number of next byte to read */
+	unsigned long lr_used;	/* last use, for recycling the slot */
 #if SUSPENDABLE
-	int log_proc_nr,
-		log_source,
-		log_iosize,
-		log_revive_alerted,
-		log_status;	/* proc that is blocking on read */
-	vir_bytes log_user_vir;
+	int	lr_suspended,	/* reader is blocked on a read */
+		lr_source,	/* FS that sent the blocking read */
+		lr_iosize,	/* bytes requested by the blocking read */
+		lr_revive_alerted,
+		lr_status;	/* result of the revived read */
+	vir_bytes lr_user_vir;
 #endif
+};
+
+struct logdevice {
+	char log_buffer[LOG_SIZE];
+	unsigned long log_seq;	/* sequence number of next byte written */
+	unsigned long log_clock;	/* reader use counter */
+	struct logreader log_reader[NR_LOG_READERS];
 	int	log_selected, log_select_proc,
 		log_select_alerted, log_select_ready_ops;
+	int	log_select_reader;	/* process that is selecting */
 };
 
 /* Function prototypes. */
@@ -34,4 +48,10 @@ _PROTOTYPE( void kputc, (int c)						);
 _PROTOTYPE( int do_new_kmess, (message *m)				);
 _PROTOTYPE( int do_diagnostics, (message *m)				);
 _PROTOTYPE( void log_append, (char *buf, int len)				);
+_PROTOTYPE( int log_copy, (int proc_nr, vir_bytes user_vir, int len)	);
+_PROTOTYPE( void log_dropped, (unsigned long bytes)			);
 
+/* trace.c */
+_PROTOTYPE( int trace_read, (int proc_nr, vir_bytes user_vir, int count)	);
+_PROTOTYPE( int trace_write, (int proc_nr, vir_bytes user_vir, int count)	);
+_PROTOTYPE( int do_trace_events, (message *m_ptr)			);
@@ -0,0 +1,223 @@
+/* This file implements /dev/trace, the binary trace device. A ring of trace
+ * records is kept for every source. Records of the kernel are fetched from
+ * the kernel's own ring whenever /dev/trace is read; records of servers and
+ * drivers arrive in batches with TRACE_EVENTS messages. A read returns the
+ * whole records of all sources that are new since the previous read, and
+ * never blocks. Writing a long sets the mask of event classes to record, and
+ * notifies the servers and drivers that send records, so that they fetch it.
+ *
+ * If a source produced more records than fit in its ring between two reads,
+ * the reader gets a TEV_LOST record telling how many were overwritten.
+ *
+ * The entry points into this file are:
+ *   trace_read:	copy new trace records to a reader
+ *   trace_write:	set the mask of enabled event classes
+ *   do_trace_events:	accept a batch of records from a server or driver
+ */
+
+#include "log.h"
+#include <minix/trace.h>
+
+#define TRACE_RING	1024	/* records per source, must be power of 2 */
+
+PRIVATE struct tracering {
+  unsigned long tr_next;		/* sequence number of next record */
+  unsigned long tr_read;		/* sequence number of next to read */
+  struct trace_rec tr_rec[TRACE_RING];
+} rings[NR_TRACE_SOURCES];
+
+PRIVATE long class_mask;		/* enabled event classes */
+PRIVATE int trace_proc[NR_TRACE_SOURCES] = {	/* who to notify per source */
+  NONE, FS_PROC_NR, DRVR_PROC_NR
+};
+PRIVATE unsigned kt_seen;		/* kernel sequence already fetched */
+PRIVATE int kt_absent;			/* kernel was built without tracing */
+PRIVATE struct ktrace kcopy;		/* copy of the kernel ring */
+PRIVATE struct trace_rec batch[TRACE_BATCH];	/* records from a server */
+
+FORWARD _PROTOTYPE( void ring_append, (struct tracering *rp,
+				struct trace_rec *rec, int n) 		);
+FORWARD _PROTOTYPE( void ring_lost, (struct tracering *rp, int source,
+				unsigned long lost)			);
+FORWARD _PROTOTYPE( void lost_note, (struct trace_rec *tr, int source,
+				unsigned long lost)			);
+FORWARD _PROTOTYPE( int kernel_fetch, (long mask)			);
+
+/*===========================================================================*
+ *				trace_read				     *
+ *===========================================================================*/
+/* process doing the read */
+/* where the records go */
+/* bytes wanted */
+PUBLIC int trace_read(int proc_nr, vir_bytes user_vir, int count)
+{
+/* Copy as many whole records as fit to the reader, source by source. */
+  struct tracering *rp;
+  unsigned long avail;
+  unsigned pos, chunk, n;
+  int r, total = 0;
+
+  if ((r = kernel_fetch(-1L)) != OK) return(r);
+
+  n = count / sizeof(struct trace_rec);
+  for (rp = &rings[0]; rp < &rings[NR_TRACE_SOURCES] && n > 0; rp++) {
+	/* A reader more than a ring behind lost the oldest records. */
+	if ((avail = rp->tr_next - rp->tr_read) > TRACE_RING) {
+		ring_lost(rp, rp - rings, avail - TRACE_RING);
+		avail = TRACE_RING;
+	}
+	while (avail > 0 && n > 0) {
+		pos = rp->tr_read & (TRACE_RING-1);
+		chunk = TRACE_RING - pos;
+		if (chunk > avail) chunk = avail;
+		if (chunk > n) chunk = n;
+		if ((r = sys_vircopy(SELF, D, (vir_bytes) &rp->tr_rec[pos],
+			proc_nr, D, user_vir,
+			chunk * sizeof(struct trace_rec))) != OK) return(r);
+		rp->tr_read += chunk;
+		user_vir += chunk * sizeof(struct trace_rec);
+		total += chunk * sizeof(struct trace_rec);
+		avail -= chunk;
+		n -= chunk;
+	}
+  }
+  return(total);
+}
+
+/*===========================================================================*
+ *				trace_write				     *
+ *===========================================================================*/
+/* process doing the write */
+/* where the mask is */
+/* bytes offered */
+PUBLIC int trace_write(int proc_nr, vir_bytes user_vir, int count)
+{
+/* Set the mask of enabled event classes. The kernel part takes effect right
+ * away; servers and drivers are notified and ask for the new mask.
+ */
+  long mask;
+  int r, s;
+
+  if (count < sizeof(mask)) return(EINVAL);
+  if ((r = sys_datacopy(proc_nr, user_vir, SELF, (vir_bytes) &mask,
+	(phys_bytes) sizeof(mask))) != OK) return(r);
+  if (mask < 0) return(EINVAL);
+  if ((r = kernel_fetch(mask & TC_KERNEL)) != OK) return(r);
+  if (mask != class_mask) {
+	class_mask = mask;
+	for (s = TRS_KERNEL+1; s < NR_TRACE_SOURCES; s++)
+		if (trace_proc[s] != NONE) notify(trace_proc[s]);
+  }
+  return(count);
+}
+
+/*===========================================================================*
+ *				do_trace_events				     *
+ *===========================================================================*/
+/* TRACE_EVENTS request */
+PUBLIC int do_trace_events(message *m_ptr)
+{
+/* A server or driver hands over a batch of records, possibly an empty one
+ * to learn the current mask. The reply status is the mask. The sender is
+ * remembered, so that it is notified when the mask changes.
+ */
+  int source, n, r;
+
+  source = m_ptr->TRACE_SOURCE;
+  n = m_ptr->TRACE_COUNT;
+  if (source <= TRS_KERNEL || source >= NR_TRACE_SOURCES) return(EINVAL);
+  if (n < 0 || n > TRACE_BATCH) return(EINVAL);
+  trace_proc[source] = m_ptr->m_source;
+
+  if (n > 0) {
+	if ((r = sys_datacopy(m_ptr->m_source, (vir_bytes) m_ptr->TRACE_BUF,
+		SELF, (vir_bytes) batch,
+		(phys_bytes) (n * sizeof(struct trace_rec)))) != OK) return(r);
+	ring_append(&rings[source], batch, n);
+  }
+  return((int) class_mask);
+}
+
+/*===========================================================================*
+ *				kernel_fetch				     *
+ *===========================================================================*/
+/* new kernel mask, or -1 to keep */
+PRIVATE int kernel_fetch(long mask)
+{
+/* Get a copy of the kernel ring and append what is new to our own ring. A
+ * kernel built without ENABLE_K_TRACE refuses; then there are no kernel
+ * records, and the rings of servers and drivers work all the same.
+ */
+  struct trace_rec note;
+  unsigned new;
+  int r;
+
+  if (kt_absent) return(OK);
+  if ((r = sys_getktrace(&kcopy, mask)) != OK) {
+	if (r != EINVAL) return(r);
+	kt_absent = TRUE;
+	return(OK);
+  }
+
+  /* If the kernel overwrote records before we got here, say so first. The
+   * note gets the time of the oldest record left, to keep the order.
+   */
+  new = kcopy.kt_next - kt_seen;
+  if (new > KTRACE_SIZE) {
+	kt_seen = kcopy.kt_next - KTRACE_SIZE;
+	note = kcopy.kt_rec[kt_seen & (KTRACE_SIZE-1)];
+	lost_note(&note, TRS_KERNEL, new - KTRACE_SIZE);
+	ring_append(&rings[TRS_KERNEL], &note, 1);
+  }
+  while (kt_seen != kcopy.kt_next) {
+	ring_append(&rings[TRS_KERNEL],
+		&kcopy.kt_rec[kt_seen & (KTRACE_SIZE-1)], 1);
+	kt_seen++;
+  }
+  return(OK);
+}
+
+/*===========================================================================*
+ *				ring_append				     *
+ *===========================================================================*/
+/* ring to append to */
+/* records to append */
+/* number of records */
+PRIVATE void ring_append(struct tracering *rp, struct trace_rec *rec, int n)
+{
+  while (n-- > 0) {
+	rp->tr_rec[rp->tr_next & (TRACE_RING-1)] = *rec++;
+	rp->tr_next++;
+  }
+}
+
+/*===========================================================================*
+ *				ring_lost				     *
+ *===========================================================================*/
+/* ring that overflowed */
+/* its source number */
+/* number of records lost */
+PRIVATE void ring_lost(struct tracering *rp, int source, unsigned long lost)
+{
+/* Records were overwritten before they could be read. Move the read mark up
+ * to the oldest record left, and turn that record into a note saying how
+ * many were lost, so that a decoder knows the trace has a hole.
+ */
+  rp->tr_read = rp->tr_next - TRACE_RING;
+  lost_note(&rp->tr_rec[rp->tr_read & (TRACE_RING-1)], source, lost + 1);
+}
+
+/*===========================================================================*
+ *				lost_note				     *
+ *===========================================================================*/
+/* record to turn into a note */
+/* source that lost records */
+/* number of records lost */
+PRIVATE void lost_note(struct trace_rec *tr, int source, unsigned long lost)
+{
+  tr->tr_event = TEV_LOST;
+  tr->tr_proc = NONE;
+  tr->tr_arg[0] = source;
+  tr->tr_arg[1] = lost;
+  tr->tr_arg[2] = 0;
+}
@@ -1,12 +1,22 @@
 /* This file contains the device dependent part of the drivers for the
  * following special files:
  *     /dev/ram		- RAM disk 
+ *     /dev/ram1, ...	- more RAM disks
  *     /dev/mem		- absolute memory
  *     /dev/kmem	- kernel virtual memory
  *     /dev/null	- null device (data sink)
  *     /dev/boot	- boot device loaded from boot image 
  *     /dev/zero	- null byte stream generator
  *
+ * A RAM disk is kept in chunks of RAM_CHUNK bytes, taken when they are first
+ * written; reading a chunk that is not there gives zeros. Its size only sets
+ * a limit, and can be changed at any time. The pages of a chunk that were
+ * written are tracked, so that a chunk is freed when all of them are
+ * discarded, as FS does for zones it frees. Chunks come from units of
+ * RAM_UNIT bytes allocated from PM, and a unit goes back to PM only when all
+ * its chunks are free. Giving back chunks one by one would leave PM with more
+ * holes than its table has room for.
+ *
  *  Changes:
  *	Apr 29, 2005	added null byte generator  (Jorrit N. Herder)
  *	Apr 09, 2005	added support for boot device  (Jorrit N. Herder)
@@ -23,7 +33,18 @@
 
 #include "assert.h"
 
-#define NR_DEVS            6		/* number of minor devices */
+#define NR_DEVS  (RAM1_DEV + NR_RAM_DEVS - 1)	/* number of minor devices */
+
+#define RAM_CHUNK	65536L		/* RAM disk allocation unit */
+#define RAM_PAGE	 4096		/* RAM disk discard unit */
+#define RAM_CHUNKS	 4096		/* most chunks in a RAM disk */
+#define PAGES_PER_CHUNK	((unsigned) (RAM_CHUNK / RAM_PAGE))
+#define CHUNKS_PER_UNIT	16		/* chunks allocated from PM at once */
+#define RAM_UNIT	(RAM_CHUNK * CHUNKS_PER_UNIT)
+#define RAM_UNITS	(NR_RAM_DEVS * RAM_CHUNKS / CHUNKS_PER_UNIT)
+#define ALL_CHUNKS	((u16_t) ((1L << CHUNKS_PER_UNIT) - 1))
+#define IS_RAM(d)	((d) == RAM_DEV || (d) >= RAM1_DEV)
+#define RAM_INDEX(d)	((d) == RAM_DEV ? 0 : (d) - RAM1_DEV + 1)
 
 PRIVATE struct device m_geom[NR_DEVS];  /* base and size of each device */
 PRIVATE int m_seg[NR_DEVS];  		/* segment index of each device */
@@ -31,6 +52,16 @@ PRIVATE int m_device;			/* current device */
 PRIVATE struct kinfo kinfo;		/* kernel information */ 
 PRIVATE struct machine machine;		/* machine information */ 
 
+PRIVATE struct ramdisk {
+  phys_bytes rd_base[RAM_CHUNKS];	/* where each chunk is, 0 if absent */
+  u16_t rd_pages[RAM_CHUNKS];		/* pages of each chunk in use */
+} ramdisk[NR_RAM_DEVS];
+
+PRIVATE struct ramunit {
+  phys_bytes ru_base;			/* where the unit is, 0 if absent */
+  u16_t ru_free;			/* its chunks not in use */
+} ramunit[RAM_UNITS];
+
 extern int errno;			/* error number for PM calls */
 
 FORWARD _PROTOTYPE( char *m_name, (void) 				);
@@ -41,6 +72,12 @@ FORWARD _PROTOTYPE( int m_do_open, (struct driver *dp, message *m_ptr) 	);
 FORWARD _PROTOTYPE( void m_init, (void) );
 FORWARD _PROTOTYPE( int m_ioctl, (struct driver *dp, message *m_ptr) 	);
 FORWARD _PROTOTYPE( void m_geometry, (struct partition *entry) 		);
+FORWARD _PROTOTYPE( int ram_transfer, (int proc_nr, int opcode,
+		off_t position, vir_bytes user_vir, unsigned count)	);
+FORWARD _PROTOTYPE( void ram_discard, (struct ramdisk *rd, u32_t pos,
+		u32_t size)						);
+FORWARD _PROTOTYPE( int chunk_alloc, (phys_bytes *basep)		);
+FORWARD _PROTOTYPE( void chunk_free, (phys_bytes base)			);
 
 /* Entry points to this driver. */
 PRIVATE struct driver m_dtab = {
@@ -60,10 +97,6 @@ PRIVATE struct driver m_dtab = {
   NULL
 };
 
-/* Buffer for the /dev/zero null byte feed. */
-#define ZERO_BUF_SIZE 			1024
-PRIVATE char dev_zero[ZERO_BUF_SIZE];
-
 #define click_to_round_k(n) \
 	((unsigned) ((((unsigned long) (n) << CLICK_SHIFT) + 512) / 1024))
 
@@ -111,9 +144,9 @@ PRIVATE struct device *m_prepare(int device)
 PRIVATE int m_transfer(int proc_nr, int opcode, off_t position, iovec_t *iov, unsigned nr_req)
 {
 /* Read or write one the driver's minor devices. */
-  phys_bytes mem_phys;
+  phys_bytes mem_phys, user_phys;
   int seg;
-  unsigned count, left, chunk;
+  unsigned count;
   vir_bytes user_vir;
   struct device *dv;
   unsigned long dv_size;
@@ -136,8 +169,7 @@ PRIVATE int m_transfer(int proc_nr, int opcode, off_t position, iovec_t *iov, un
 	    if (opcode == DEV_GATHER) return(OK);	/* always at EOF */
 	    break;
 
-	/* Virtual copying. For RAM disk, kernel memory and boot device. */
-	case RAM_DEV:
+	/* Virtual copying. For kernel memory and boot device. */
 	case KMEM_DEV:
 	case BOOT_DEV:
 	    if (position >= dv_size) return(OK); 	/* check for EOF */
@@ -166,24 +198,27 @@ PRIVATE int m_transfer(int proc_nr, int opcode, off_t position, iovec_t *iov, un
 	    }
 	    break;
 
-	/* Null byte stream generator. */
+	/* Null byte stream generator. The kernel zeroes the whole buffer at
+	 * once, in the physical memory it is in.
+	 */
 	case ZERO_DEV:
-	    if (opcode == DEV_GATHER) {
-	        left = count;
-	    	while (left > 0) {
-	    	    chunk = (left > ZERO_BUF_SIZE) ? ZERO_BUF_SIZE : left;
-	    	    if (OK != (s=sys_vircopy(SELF, D, (vir_bytes) dev_zero, 
-	    	            proc_nr, D, user_vir, chunk)))
-	    	        report("MEM","sys_vircopy failed", s);
-	    	    left -= chunk;
- 	            user_vir += chunk;
-	    	}
+	    if (opcode == DEV_GATHER && count > 0) {
+	        if (OK != (s=sys_umap(proc_nr, D, user_vir, count, &user_phys)))
+	            return(s);
+	        if (OK != (s=sys_memset(0, user_phys, count)))
+	            return(s);
 	    }
 	    break;
 
-	/* Unknown (illegal) minor device. */
+	/* RAM disks, or unknown (illegal) minor device. */
 	default:
-	    return(EINVAL);
+	    if (!IS_RAM(m_device)) return(EINVAL);
+	    if (position >= dv_size) return(OK); 	/* check for EOF */
+	    if (position + count > dv_size) count = dv_size - position;
+	    if ((s = ram_transfer(proc_nr, opcode, position, user_vir, count))
+	    							!= OK)
+	    	return(s);
+	    break;
 	}
 
 	/* Book the number of bytes transferred. */
@@ -215,7 +250,7 @@ PRIVATE int m_do_open(struct driver *dp, message *m_ptr)
 PRIVATE void m_init()
 {
   /* Initialize this task. All minor devices are initialized one by one. */
-  int i, s;
+  int s;
 
   if (OK != (s=sys_getkinfo(&kinfo))) {
       panic("MEM","Couldn't get kernel information.",s);
@@ -239,11 +274,6 @@ PRIVATE void m_init()
       }
   }
 
-  /* Initialize /dev/zero. Simply write zeros into the buffer. */
-  for (i=0; i<ZERO_BUF_SIZE; i++) {
-       dev_zero[i] = '\0';
-  }
-
   /* Set up memory ranges for /dev/mem. */
   if (OK != (s=sys_getmachine(&machine))) {
       panic("MEM","Couldn't get machine information.",s);
@@ -262,37 +292,60 @@ PRIVATE void m_init()
 /* pointer to control message */
 PRIVATE int m_ioctl(struct driver *dp, message *m_ptr)
 {
-/* I/O controls for the memory driver. Currently there is one I/O control:
- * - MIOCRAMSIZE: to set the size of the RAM disk.
+/* I/O controls for the memory driver. Currently there are two I/O controls:
+ * - MIOCRAMSIZE: to set the size of a RAM disk.
+ * - MIOCDISCARD: to tell that a range of a RAM disk is no longer needed.
  */
   struct device *dv;
+  struct ramdisk *rd;
   if ((dv = m_prepare(m_ptr->DEVICE)) == NIL_DEV) return(ENXIO);
 
   switch (m_ptr->REQUEST) {
     case MIOCRAMSIZE: {
-	/* FS wants to create a new RAM disk with the given size. */
-	phys_bytes ramdev_size;
-	phys_bytes ramdev_base;
+	/* Set the size of a RAM disk. FS passes it in the message, as it does
+	 * for the root RAM disk; others pass it the usual way.
+	 */
+	u32_t ramdev_size;
+	unsigned c;
 	int s;
 
-	if (m_ptr->PROC_NR != FS_PROC_NR) {
+	if (!IS_RAM(m_device)) return(ENOTTY);
+	if (m_ptr->PROC_NR == FS_PROC_NR) {
+	    ramdev_size = m_ptr->POSITION;
+	} else if (m_device == RAM_DEV) {
 	    report("MEM", "warning, MIOCRAMSIZE called by", m_ptr->PROC_NR);
 	    return(EPERM);
+	} else if ((s = sys_datacopy(m_ptr->PROC_NR, (vir_bytes) m_ptr->ADDRESS,
+		SELF, (vir_bytes) &ramdev_size, sizeof(ramdev_size))) != OK) {
+	    return(s);
+	}
+	if (ramdev_size > RAM_CHUNKS * RAM_CHUNK) return(ENOMEM);
+
+	/* Memory is allocated as it is written; a smaller disk gives back
+	 * the chunks past its end.
+	 */
+	rd = &ramdisk[RAM_INDEX(m_device)];
+	for (c = (ramdev_size + RAM_CHUNK - 1) / RAM_CHUNK; c < RAM_CHUNKS; c++){
+	    if (rd->rd_base[c] != 0) {
+		chunk_free(rd->rd_base[c]);
+		rd->rd_base[c] = 0;
+		rd->rd_pages[c] = 0;
+	    }
 	}
-
-	/* Try to allocate a piece of memory for the RAM disk. */
-	ramdev_size = m_ptr->POSITION;
-        if (allocmem(ramdev_size, &ramdev_base) < 0) {
-            report("MEM", "warning, allocmem failed", errno);
-            return(ENOMEM);
-        }
-	dv->dv_base = cvul64(ramdev_base);
 	dv->dv_size = cvul64(ramdev_size);
+	break;
+    }
+
+    case MIOCDISCARD: {
+	/* A file system freed a range of a RAM disk. */
+	struct ramdiscard range;
+	int s;
 
-  	if (OK != (s=sys_segctl(&m_seg[RAM_DEV], (u16_t *) &s, (vir_bytes *) &s, 
-  		ramdev_base, ramdev_size))) {
-      		panic("MEM","Couldn't install remote segment.",s);
-  	}
+	if (!IS_RAM(m_device)) return(ENOTTY);
+	if ((s = sys_datacopy(m_ptr->PROC_NR, (vir_bytes) m_ptr->ADDRESS,
+		SELF, (vir_bytes) &range, sizeof(range))) != OK) return(s);
+	ram_discard(&ramdisk[RAM_INDEX(m_device)], range.rd_pos,
+							range.rd_size);
 	break;
     }
 
@@ -302,6 +355,149 @@ PRIVATE int m_ioctl(struct driver *dp, message *m_ptr)
   return(OK);
 }
 
+/*===========================================================================*
+ *				ram_transfer				     *
+ *===========================================================================*/
+/* process doing the request */
+/* DEV_GATHER or DEV_SCATTER */
+/* offset on the RAM disk */
+/* user buffer */
+/* bytes to copy, within the disk */
+PRIVATE int ram_transfer(int proc_nr, int opcode, off_t position,
+			 vir_bytes user_vir, unsigned count)
+{
+/* Copy between a user buffer and the current RAM disk, chunk by chunk. A
+ * chunk is taken and cleared when it is first written.
+ */
+  struct ramdisk *rd;
+  phys_bytes base, user_phys;
+  unsigned c, off, n, first, last;
+  int s;
+
+  rd = &ramdisk[RAM_INDEX(m_device)];
+  while (count > 0) {
+	c = position / RAM_CHUNK;
+	off = position % RAM_CHUNK;
+	n = RAM_CHUNK - off;
+	if (n > count) n = count;
+	base = rd->rd_base[c];
+
+	if (opcode == DEV_GATHER) {
+	    if (base == 0) {
+		/* Nothing was written here. */
+		if ((s = sys_umap(proc_nr, D, user_vir, n, &user_phys)) != OK)
+			return(s);
+		if ((s = sys_memset(0, user_phys, n)) != OK) return(s);
+	    } else {
+		if ((s = sys_physcopy(NONE, PHYS_SEG, base + off,
+			proc_nr, D, user_vir, n)) != OK) return(s);
+	    }
+	} else {
+	    if (base == 0) {
+		if ((s = chunk_alloc(&base)) != OK) return(s);
+		if ((s = sys_memset(0, base, RAM_CHUNK)) != OK) {
+			chunk_free(base);
+			return(s);
+		}
+		rd->rd_base[c] = base;
+	    }
+	    if ((s = sys_physcopy(proc_nr, D, user_vir, NONE, PHYS_SEG,
+						base + off, n)) != OK) return(s);
+	    first = off / RAM_PAGE;
+	    last = (off + n - 1) / RAM_PAGE;
+	    rd->rd_pages[c] |= ((1L << (last + 1)) - 1) & ~((1L << first) - 1);
+	}
+	position += n;
+	user_vir += n;
+	count -= n;
+  }
+  return(OK);
+}
+
+/*===========================================================================*
+ *				ram_discard				     *
+ *===========================================================================*/
+/* RAM disk */
+/* start of the range no longer needed */
+/* its size */
+PRIVATE void ram_discard(struct ramdisk *rd, u32_t pos, u32_t size)
+{
+/* Forget the pages that are wholly inside the range. A chunk that has none
+ * in use any more is freed.
+ */
+  u32_t p, end;
+  unsigned c;
+
+  p = (pos + RAM_PAGE - 1) / RAM_PAGE;
+  end = (pos + size) / RAM_PAGE;
+  if (end > RAM_CHUNKS * PAGES_PER_CHUNK) end = RAM_CHUNKS * PAGES_PER_CHUNK;
+  for ( ; p < end; p++) {
+	c = p / PAGES_PER_CHUNK;
+	if (rd->rd_base[c] == 0) continue;
+	rd->rd_pages[c] &= ~(1 << (unsigned) (p % PAGES_PER_CHUNK));
+	if (rd->rd_pages[c] == 0) {
+		chunk_free(rd->rd_base[c]);
+		rd->rd_base[c] = 0;
+	}
+  }
+}
+
+/*===========================================================================*
+ *				chunk_alloc				     *
+ *===========================================================================*/
+/* where to put the address of the chunk */
+PRIVATE int chunk_alloc(phys_bytes *basep)
+{
+/* Take a free chunk of a unit, or allocate a new unit from PM. */
+  struct ramunit *ru, *empty;
+  unsigned i;
+
+  empty = NULL;
+  for (ru = &ramunit[0]; ru < &ramunit[RAM_UNITS]; ru++) {
+	if (ru->ru_base == 0) {
+		if (empty == NULL) empty = ru;
+		continue;
+	}
+	if (ru->ru_free == 0) continue;
+	for (i = 0; (ru->ru_free & (1 << i)) == 0; i++) {}
+	ru->ru_free &= ~(1 << i);
+	*basep = ru->ru_base + i * RAM_CHUNK;
+	return(OK);
+  }
+  if (empty == NULL) return(ENOMEM);
+  if (allocmem((phys_bytes) RAM_UNIT, &empty->ru_base) < 0) {
+	report("MEM", "warning, allocmem failed", errno);
+	empty->ru_base = 0;
+	return(ENOMEM);
+  }
+  empty->ru_free = ALL_CHUNKS & ~1;
+  *basep = empty->ru_base;
+  return(OK);
+}
+
+/*===========================================================================*
+ *				chunk_free				     *
+ *===========================================================================*/
+/* address of the chunk */
+PRIVATE void chunk_free(phys_bytes base)
+{
+/* Put a chunk back in its unit, and give the unit back to PM if it is now
+ * wholly free.
+ */
+  struct ramunit *ru;
+
+  for (ru = &ramunit[0]; ru < &ramunit[RAM_UNITS]; ru++) {
+	if (ru->ru_base == 0 || base < ru->ru_base
+				|| base >= ru->ru_base + RAM_UNIT) continue;
+	ru->ru_free |= 1 << (unsigned) ((base - ru->ru_base) / RAM_CHUNK);
+	if (ru->ru_free == ALL_CHUNKS) {
+		(void) freemem((phys_bytes) RAM_UNIT, ru->ru_base);
+		ru->ru_base = 0;
+	}
+	return;
+  }
+}
+
 /*===========================================================================*
  *				m_geometry				     *
  *===========================================================================*/
@@ -14,6 +14,14 @@
  * (word) addresses for simplicity and assume there is no wrapping.  The
  * assembly support functions translate the word addresses to byte addresses
  * and the scrolling function worries about wrapping.
+ *
+ * Output is not written to video memory directly.  Each console keeps a shadow
+ * copy of its screen in ordinary memory, and output, scrolling and escape
+ * sequences only change the shadow and mark rows dirty.  Once per round of
+ * the TTY main loop cons_render() copies the dirty rows to video memory,
+ * scrolls by moving the origin, and sets the 6845 registers in one go.  This
+ * way a burst of output costs a few copies of whole lines and one kernel call
+ * for the cursor, no matter how many lines scroll by.
  */
 
 #include "../drivers.h"
@@ -35,8 +43,8 @@
 #define BLANK_COLOR   0x0700	/* determines cursor color on blank screen */
 #define SCROLL_UP          0	/* scroll forward */
 #define SCROLL_DOWN        1	/* scroll backward */
-#define BLANK_MEM ((u16_t *) 0)	/* tells mem_vid_copy() to blank the screen */
 #define CONS_RAM_WORDS    80	/* video ram buffer size */
+#define CONS_OUT_BYTES  1024	/* user bytes fetched per copy in cons_write */
 #define MAX_ESC_PARMS      4	/* number of escape sequence params allowed */
 
 /* Constants relating to the controller chips. */
@@ -66,7 +74,6 @@ PUBLIC u16_t vid_seg;
 PUBLIC vir_bytes vid_off;	/* video ram is found at vid_seg:vid_off */
 PUBLIC unsigned vid_size;	/* 0x2000 for color or 0x0800 for mono */
 PUBLIC unsigned vid_mask;	/* 0x1FFF for color or 0x07FF for mono */
-PUBLIC unsigned blank_color = BLANK_COLOR; /* display code for blank */
 
 /* Private variables used by the console driver. */
 PRIVATE int vid_port;		/* I/O port for accessing 6845 */
@@ -77,6 +84,10 @@ PRIVATE unsigned font_lines;	/* font lines per character */
 PRIVATE unsigned scr_width;	/* # characters on a line */
 PRIVATE unsigned scr_lines;	/* # lines on the screen */
 PRIVATE unsigned scr_size;	/* # characters on the screen */
+PRIVATE unsigned vid_org = -1;	/* origin the 6845 is set to */
+PRIVATE unsigned vid_cur = -1;	/* cursor position the 6845 is set to */
+PRIVATE char cons_outbuf[CONS_OUT_BYTES]; /* staging buffer for user output */
+PRIVATE u16_t shadow_mem[EGA_SIZE/2];	/* shadow screens of all consoles */
 
 /* Per console data. */
 typedef struct console {
@@ -84,10 +95,17 @@ typedef struct console {
   int c_column;			/* current column number (0-origin) */
   int c_row;			/* current row (0 at top of screen) */
   int c_rwords;			/* number of WORDS (not bytes) in outqueue */
+  int c_qrow;			/* row where the outqueue goes */
+  int c_qcol;			/* column where the outqueue goes */
   unsigned c_start;		/* start of video memory of this console */
   unsigned c_limit;		/* limit of this console's video memory */
   unsigned c_org;		/* location in RAM where 6845 base points */
   unsigned c_cur;		/* current position of cursor in video RAM */
+  u16_t *c_shadow;		/* shadow copy of the screen */
+  int c_top;			/* shadow line shown on the top row */
+  int c_scroll;			/* lines scrolled up (down < 0) since render */
+  int c_dirty_lo;		/* first row that must be rendered */
+  int c_dirty_hi;		/* last row that must be rendered */
   unsigned c_attr;		/* character attribute */
   unsigned c_blank;		/* blank attribute */
   char c_reverse;		/* reverse video */
@@ -105,6 +123,18 @@ PRIVATE console_t *curcons;	/* currently visible */
 /* Color if using a color controller. */
 #define color	(vid_port == C_6845)
 
+/* Start of a screen row in the shadow, which is circular by lines. */
+#define shadow_row(cons, row) \
+	((cons)->c_shadow + (((cons)->c_top + (row)) % scr_lines) * scr_width)
+
+/* Mark rows lo to hi of a console as needing to be rendered. */
+#define mark_dirty(cons, lo, hi) do { \
+	if ((lo) < (cons)->c_dirty_lo) (cons)->c_dirty_lo = (lo); \
+	if ((hi) > (cons)->c_dirty_hi) (cons)->c_dirty_hi = (hi); \
+} while (0)
+#define mark_clean(cons) \
+	((cons)->c_dirty_lo = scr_lines, (cons)->c_dirty_hi = -1)
+
 /* Map from ANSI colors to the attributes used by the PC */
 PRIVATE int ansi_colors[8] = {0, 4, 2, 6, 1, 5, 3, 7};
 
@@ -124,7 +154,12 @@ FORWARD _PROTOTYPE( void do_escape, (console_t *cons, int c)		);
 FORWARD _PROTOTYPE( void flush, (console_t *cons)			);
 FORWARD _PROTOTYPE( void parse_escape, (console_t *cons, int c)		);
 FORWARD _PROTOTYPE( void scroll_screen, (console_t *cons, int dir)	);
-FORWARD _PROTOTYPE( void set_6845, (int reg, unsigned val)		);
+FORWARD _PROTOTYPE( void blank_chars, (console_t *cons, int row, int col,
+							unsigned count)	);
+FORWARD _PROTOTYPE( void move_rows, (console_t *cons, int src, int dst,
+							int count)	);
+FORWARD _PROTOTYPE( void render, (console_t *cons)			);
+FORWARD _PROTOTYPE( void update_6845, (console_t *cons)			);
 FORWARD _PROTOTYPE( void get_6845, (int reg, unsigned *val)		);
 FORWARD _PROTOTYPE( void stop_beep, (timer_t *tmrp)			);
 FORWARD _PROTOTYPE( void cons_org0, (void)				);
@@ -142,10 +177,12 @@ PRIVATE int cons_write(register struct tty *tp, int try)
  * finished, and the counts updated.  Keep repeating until all I/O done.
  */
 
-  int count;
+  int count, n;
   int result;
   register char *tbuf;
-  char buf[64];
+  char *tend;
+  register u16_t *qp;
+  register unsigned attr;
   console_t *cons = tp->tty_priv;
 
   if (try) return 1;	/* we can always write to console */
@@ -155,37 +192,52 @@ PRIVATE int cons_write(register struct tty *tp, int try)
    */
   if ((count = tp->tty_outleft) == 0 || tp->tty_inhibited) return;
 
-  /* Copy the user bytes to buf[] for decent addressing. Loop over the
-   * copies, since the user buffer may be much larger than buf[].
+  /* Copy the user bytes to cons_outbuf[] for decent addressing.  Loop over
+   * the copies, since the user buffer may be much larger than the buffer.
+   * The buffer is static, because the TTY stack is tiny, and large, because
+   * every copy is a kernel call.
    */
   do {
-	if (count > sizeof(buf)) count = sizeof(buf);
+	if (count > sizeof(cons_outbuf)) count = sizeof(cons_outbuf);
 	if ((result = sys_vircopy(tp->tty_outproc, D, tp->tty_out_vir, 
-			SELF, D, (vir_bytes) buf, (vir_bytes) count)) != OK)
+		SELF, D, (vir_bytes) cons_outbuf, (vir_bytes) count)) != OK)
 		break;
-	tbuf = buf;
+	tbuf = cons_outbuf;
+	tend = cons_outbuf + count;
 
 	/* Update terminal data structure. */
 	tp->tty_out_vir += count;
 	tp->tty_outcum += count;
 	tp->tty_outleft -= count;
 
-	/* Output each byte of the copy to the screen.  Avoid calling
-	 * out_char() for the "easy" characters, put them into the buffer
-	 * directly.
+	/* Output the bytes of the copy to the screen.  Control characters,
+	 * escape sequences, line wraps and a full ramqueue are left to
+	 * out_char().  Runs of "easy" characters are put into the ramqueue
+	 * directly, as many as fit on the rest of the line at a time.
 	 */
-	do {
+	while (tbuf < tend) {
 		if ((unsigned) *tbuf < ' ' || cons->c_esc_state > 0
 			|| cons->c_column >= scr_width
 			|| cons->c_rwords >= buflen(cons->c_ramqueue))
 		{
 			out_char(cons, *tbuf++);
-		} else {
-			cons->c_ramqueue[cons->c_rwords++] =
-					cons->c_attr | (*tbuf++ & BYTE);
-			cons->c_column++;
+			continue;
 		}
-	} while (--count != 0);
+		n = scr_width - cons->c_column;
+		if (n > buflen(cons->c_ramqueue) - cons->c_rwords)
+			n = buflen(cons->c_ramqueue) - cons->c_rwords;
+		if (n > tend - tbuf) n = tend - tbuf;
+
+		qp = &cons->c_ramqueue[cons->c_rwords];
+		attr = cons->c_attr;
+		count = n;
+		do {
+			*qp++ = attr | (*tbuf++ & BYTE);
+		} while (--n != 0 && (unsigned) *tbuf >= ' ');
+		count -= n;
+		cons->c_rwords += count;
+		cons->c_column += count;
+	}
   } while ((count = tp->tty_outleft) != 0 && !tp->tty_inhibited);
 
   flush(cons);			/* transfer anything buffered to the screen */
@@ -306,51 +358,36 @@ PRIVATE void out_char(register console_t *cons, int c)
 /* SCROLL_UP or SCROLL_DOWN */
 PRIVATE void scroll_screen(register console_t *cons, int dir)
 {
-  unsigned new_line, new_org, chars;
+/* Scroll the shadow screen one line.  The shadow is circular by lines, so
+ * this only rotates the top line and blanks the line that comes into view.
+ * The video memory is updated by render(), which moves the 6845 origin by
+ * the number of lines scrolled in the meantime.  Rows that were dirty move
+ * along with the text.
+ */
+  int new_line;
 
   flush(cons);
-  chars = scr_size - scr_width;		/* one screen minus one line */
-
-  /* Scrolling the screen is a real nuisance due to the various incompatible
-   * video cards.  This driver supports software scrolling (Hercules?),
-   * hardware scrolling (mono and CGA cards) and hardware scrolling without
-   * wrapping (EGA cards).  In the latter case we must make sure that
-   *		c_start <= c_org && c_org + scr_size <= c_limit
-   * holds, because EGA doesn't wrap around the end of video memory.
-   */
+
   if (dir == SCROLL_UP) {
-	/* Scroll one line up in 3 ways: soft, avoid wrap, use origin. */
-	if (softscroll) {
-		vid_vid_copy(cons->c_start + scr_width, cons->c_start, chars);
-	} else
-	if (!wrap && cons->c_org + scr_size + scr_width >= cons->c_limit) {
-		vid_vid_copy(cons->c_org + scr_width, cons->c_start, chars);
-		cons->c_org = cons->c_start;
-	} else {
-		cons->c_org = (cons->c_org + scr_width) & vid_mask;
+	cons->c_top = (cons->c_top + 1) % scr_lines;
+	cons->c_scroll++;
+	if (cons->c_dirty_lo <= cons->c_dirty_hi) {
+		if (cons->c_dirty_lo > 0) cons->c_dirty_lo--;
+		cons->c_dirty_hi--;
 	}
-	new_line = (cons->c_org + chars) & vid_mask;
+	new_line = scr_lines - 1;
   } else {
-	/* Scroll one line down in 3 ways: soft, avoid wrap, use origin. */
-	if (softscroll) {
-		vid_vid_copy(cons->c_start, cons->c_start + scr_width, chars);
-	} else
-	if (!wrap && cons->c_org < cons->c_start + scr_width) {
-		new_org = cons->c_limit - scr_size;
-		vid_vid_copy(cons->c_org, new_org + scr_width, chars);
-		cons->c_org = new_org;
-	} else {
-		cons->c_org = (cons->c_org - scr_width) & vid_mask;
+	cons->c_top = (cons->c_top + scr_lines - 1) % scr_lines;
+	cons->c_scroll--;
+	if (cons->c_dirty_lo <= cons->c_dirty_hi) {
+		cons->c_dirty_lo++;
+		if (cons->c_dirty_hi < scr_lines - 1) cons->c_dirty_hi++;
 	}
-	new_line = cons->c_org;
+	new_line = 0;
   }
-  /* Blank the new line at top or bottom. */
-  blank_color = cons->c_blank;
-  mem_vid_copy(BLANK_MEM, new_line, scr_width);
 
-  /* Set the new video origin. */
-  if (cons == curcons) set_6845(VID_ORG, cons->c_org);
-  flush(cons);
+  /* Blank the new line at top or bottom. */
+  blank_chars(cons, new_line, 0, scr_width);
 }
 
 /*===========================================================================*
@@ -359,15 +396,17 @@ PRIVATE void scroll_screen(register console_t *cons, int dir)
 /* pointer to console struct */
 PRIVATE void flush(register console_t *cons)
 {
-/* Send characters buffered in 'ramqueue' to screen memory, check the new
- * cursor position, compute the new hardware cursor position and set it.
+/* Send characters buffered in 'ramqueue' to the shadow screen, and check the
+ * new cursor position.  The video memory and the hardware cursor are brought
+ * up to date later by render().
  */
-  unsigned cur;
   tty_t *tp = cons->c_tty;
 
-  /* Have the characters in 'ramqueue' transferred to the screen. */
+  /* Have the characters in 'ramqueue' transferred to the shadow. */
   if (cons->c_rwords > 0) {
-	mem_vid_copy(cons->c_ramqueue, cons->c_cur, cons->c_rwords);
+	memcpy(shadow_row(cons, cons->c_qrow) + cons->c_qcol,
+		cons->c_ramqueue, cons->c_rwords * sizeof(u16_t));
+	mark_dirty(cons, cons->c_qrow, cons->c_qrow);
 	cons->c_rwords = 0;
 
 	/* TTY likes to know the current column and if echoing messed up. */
@@ -375,18 +414,132 @@ PRIVATE void flush(register console_t *cons)
 	tp->tty_reprint = TRUE;
   }
 
-  /* Check and update the cursor position. */
+  /* Check the cursor position, the next characters will be queued there. */
   if (cons->c_column < 0) cons->c_column = 0;
   if (cons->c_column > scr_width) cons->c_column = scr_width;
   if (cons->c_row < 0) cons->c_row = 0;
   if (cons->c_row >= scr_lines) cons->c_row = scr_lines - 1;
-  cur = cons->c_org + cons->c_row * scr_width + cons->c_column;
-  if (cur != cons->c_cur) {
-	if (cons == curcons) set_6845(CURSOR, cur);
-	cons->c_cur = cur;
+  cons->c_qrow = cons->c_row;
+  cons->c_qcol = cons->c_column;
+}
+
+/*===========================================================================*
+ *				blank_chars				     *
+ *===========================================================================*/
+PRIVATE void blank_chars(register console_t *cons, int row, int col,
+							unsigned count)
+{
+/* Blank 'count' characters of the shadow screen starting at (row, col). */
+  register u16_t *p;
+  unsigned n;
+
+  while (count > 0 && row < scr_lines) {
+	p = shadow_row(cons, row) + col;
+	n = scr_width - col;
+	if (n > count) n = count;
+	count -= n;
+	mark_dirty(cons, row, row);
+	while (n > 0) { *p++ = cons->c_blank; n--; }
+	row++;
+	col = 0;
   }
 }
 
+/*===========================================================================*
+ *				move_rows				     *
+ *===========================================================================*/
+PRIVATE void move_rows(register console_t *cons, int src, int dst, int count)
+{
+/* Move 'count' rows of the shadow screen from row 'src' to row 'dst'.  The
+ * rows are not contiguous in the shadow, so copy them one at a time, in the
+ * direction that handles overlap.
+ */
+  int i;
+
+  if (count <= 0) return;
+  if (dst < src) {
+	for (i = 0; i < count; i++) {
+		memcpy(shadow_row(cons, dst + i), shadow_row(cons, src + i),
+			scr_width * sizeof(u16_t));
+	}
+  } else {
+	for (i = count - 1; i >= 0; i--) {
+		memcpy(shadow_row(cons, dst + i), shadow_row(cons, src + i),
+			scr_width * sizeof(u16_t));
+	}
+  }
+  mark_dirty(cons, dst, dst + count - 1);
+}
+
+/*===========================================================================*
+ *				render					     *
+ *===========================================================================*/
+/* pointer to console struct */
+PRIVATE void render(register console_t *cons)
+{
+/* Bring the video memory of a console up to date with its shadow screen.
+ *
+ * Scrolling the screen is a real nuisance due to the various incompatible
+ * video cards.  This driver supports software scrolling (Hercules?),
+ * hardware scrolling (mono and CGA cards) and hardware scrolling without
+ * wrapping (EGA cards).  In the latter case we must make sure that
+ *		c_start <= c_org && c_org + scr_size <= c_limit
+ * holds, because EGA doesn't wrap around the end of video memory.  Lines
+ * scrolled since the last render are handled by moving the origin if that
+ * is possible, only the rows that came into view then need to be copied.
+ * Otherwise the whole screen is redrawn from the shadow, which is cheaper
+ * than moving video memory around, because reading video memory is slow.
+ */
+  int lines, lo, hi, n;
+  unsigned chars;
+  int redraw = FALSE;
+
+  flush(cons);
+
+  if ((lines = cons->c_scroll) != 0) {
+	cons->c_scroll = 0;
+	chars = (lines > 0 ? lines : -lines) * scr_width;
+
+	if (softscroll || chars >= scr_size) {
+		redraw = TRUE;
+	} else
+	if (lines > 0) {
+		/* Scroll up in 2 ways: avoid wrap, use origin. */
+		if (!wrap && cons->c_org + scr_size + chars >= cons->c_limit) {
+			cons->c_org = cons->c_start;
+			redraw = TRUE;
+		} else {
+			cons->c_org = (cons->c_org + chars) & vid_mask;
+		}
+	} else {
+		/* Scroll down in 2 ways: avoid wrap, use origin. */
+		if (!wrap && cons->c_org < cons->c_start + chars) {
+			cons->c_org = cons->c_limit - scr_size;
+			redraw = TRUE;
+		} else {
+			cons->c_org = (cons->c_org - chars) & vid_mask;
+		}
+	}
+  }
+  if (redraw) mark_dirty(cons, 0, scr_lines - 1);
+
+  /* Copy the dirty rows, in at most two pieces because the shadow wraps. */
+  lo = cons->c_dirty_lo;
+  hi = cons->c_dirty_hi;
+  while (lo <= hi) {
+	n = scr_lines - (cons->c_top + lo) % scr_lines;
+	if (n > hi - lo + 1) n = hi - lo + 1;
+	mem_vid_copy(shadow_row(cons, lo), cons->c_org + lo * scr_width,
+							n * scr_width);
+	lo += n;
+  }
+  mark_clean(cons);
+
+  /* Compute the new hardware cursor position and set it. */
+  cons->c_cur = cons->c_org + cons->c_row * scr_width + cons->c_column;
+  if (cons == curcons) update_6845(cons);
+}
+
 /*===========================================================================*
  *				parse_escape				     *
  *===========================================================================*/
@@ -454,7 +607,8 @@ PRIVATE void parse_escape(register console_t *cons, char c)
 PRIVATE void do_escape(register console_t *cons, char c)
 {
   int value, n;
-  unsigned src, dst, count;
+  unsigned count;
+  u16_t *line;
   int *parmp;
 
   /* Some of these things hack on screen RAM, so it had better be up to date */
@@ -512,45 +666,37 @@ PRIVATE void do_escape(register console_t *cons, char c)
 	    case 'J':		/* ESC [sJ clears in display */
 		switch (value) {
 		    case 0:	/* Clear from cursor to end of screen */
-			count = scr_size - (cons->c_cur - cons->c_org);
-			dst = cons->c_cur;
+			blank_chars(cons, cons->c_row, cons->c_column,
+				scr_size - (cons->c_row * scr_width
+							+ cons->c_column));
 			break;
 		    case 1:	/* Clear from start of screen to cursor */
-			count = cons->c_cur - cons->c_org;
-			dst = cons->c_org;
+			blank_chars(cons, 0, 0,
+				cons->c_row * scr_width + cons->c_column);
 			break;
 		    case 2:	/* Clear entire screen */
-			count = scr_size;
-			dst = cons->c_org;
+			blank_chars(cons, 0, 0, scr_size);
 			break;
 		    default:	/* Do nothing */
-			count = 0;
-			dst = cons->c_org;
+			break;
 		}
-		blank_color = cons->c_blank;
-		mem_vid_copy(BLANK_MEM, dst, count);
 		break;
 
 	    case 'K':		/* ESC [sK clears line from cursor */
 		switch (value) {
 		    case 0:	/* Clear from cursor to end of line */
-			count = scr_width - cons->c_column;
-			dst = cons->c_cur;
+			blank_chars(cons, cons->c_row, cons->c_column,
+					scr_width - cons->c_column);
 			break;
 		    case 1:	/* Clear from beginning of line to cursor */
-			count = cons->c_column;
-			dst = cons->c_cur - cons->c_column;
+			blank_chars(cons, cons->c_row, 0, cons->c_column);
 			break;
 		    case 2:	/* Clear entire line */
-			count = scr_width;
-			dst = cons->c_cur - cons->c_column;
+			blank_chars(cons, cons->c_row, 0, scr_width);
 			break;
 		    default:	/* Do nothing */
-			count = 0;
-			dst = cons->c_cur;
+			break;
 		}
-		blank_color = cons->c_blank;
-		mem_vid_copy(BLANK_MEM, dst, count);
 		break;
 
 	    case 'L':		/* ESC [nL inserts n lines at cursor */
@@ -559,12 +705,9 @@ PRIVATE void do_escape(register console_t *cons, char c)
 		if (n > (scr_lines - cons->c_row))
 			n = scr_lines - cons->c_row;
 
-		src = cons->c_org + cons->c_row * scr_width;
-		dst = src + n * scr_width;
-		count = (scr_lines - cons->c_row - n) * scr_width;
-		vid_vid_copy(src, dst, count);
-		blank_color = cons->c_blank;
-		mem_vid_copy(BLANK_MEM, src, n * scr_width);
+		move_rows(cons, cons->c_row, cons->c_row + n,
+					scr_lines - cons->c_row - n);
+		blank_chars(cons, cons->c_row, 0, n * scr_width);
 		break;
 
 	    case 'M':		/* ESC [nM deletes n lines at cursor */
@@ -573,12 +716,9 @@ PRIVATE void do_escape(register console_t *cons, char c)
 		if (n > (scr_lines - cons->c_row))
 			n = scr_lines - cons->c_row;
 
-		dst = cons->c_org + cons->c_row * scr_width;
-		src = dst + n * scr_width;
-		count = (scr_lines - cons->c_row - n) * scr_width;
-		vid_vid_copy(src, dst, count);
-		blank_color = cons->c_blank;
-		mem_vid_copy(BLANK_MEM, dst + count, n * scr_width);
+		move_rows(cons, cons->c_row + n, cons->c_row,
+					scr_lines - cons->c_row - n);
+		blank_chars(cons, scr_lines - n, 0, n * scr_width);
 		break;
 
 	    case '@':		/* ESC [n@ inserts n chars at cursor */
@@ -587,12 +727,10 @@ PRIVATE void do_escape(register console_t *cons, char c)
 		if (n > (scr_width - cons->c_column))
 			n = scr_width - cons->c_column;
 
-		src = cons->c_cur;
-		dst = src + n;
+		line = shadow_row(cons, cons->c_row) + cons->c_column;
 		count = scr_width - cons->c_column - n;
-		vid_vid_copy(src, dst, count);
-		blank_color = cons->c_blank;
-		mem_vid_copy(BLANK_MEM, src, n);
+		memmove(line + n, line, count * sizeof(u16_t));
+		blank_chars(cons, cons->c_row, cons->c_column, n);
 		break;
 
 	    case 'P':		/* ESC [nP deletes n chars at cursor */
@@ -601,12 +739,10 @@ PRIVATE void do_escape(register console_t *cons, char c)
 		if (n > (scr_width - cons->c_column))
 			n = scr_width - cons->c_column;
 
-		dst = cons->c_cur;
-		src = dst + n;
+		line = shadow_row(cons, cons->c_row) + cons->c_column;
 		count = scr_width - cons->c_column - n;
-		vid_vid_copy(src, dst, count);
-		blank_color = cons->c_blank;
-		mem_vid_copy(BLANK_MEM, dst + count, n);
+		memmove(line, line + n, count * sizeof(u16_t));
+		blank_chars(cons, cons->c_row, cons->c_column + count, n);
 		break;
 
 	    case 'm':		/* ESC [nm enables rendition n */
@@ -689,22 +825,34 @@ PRIVATE void do_escape(register console_t *cons, char c)
 }
 
 /*===========================================================================*
- *				set_6845				     *
+ *				update_6845				     *
  *===========================================================================*/
-/* which register pair to set */
-/* 16-bit value to set it to */
-PRIVATE void set_6845(int reg, unsigned val)
+/* pointer to console struct */
+PRIVATE void update_6845(register console_t *cons)
 {
-/* Set a register pair inside the 6845.
+/* Set the register pairs inside the 6845 to show this console.
  * Registers 12-13 tell the 6845 where in video ram to start
  * Registers 14-15 tell the 6845 where to put the cursor
+ * Only the pairs that changed are set, together in a single kernel call.
  */
-  pvb_pair_t char_out[4];
-  pv_set(char_out[0], vid_port + INDEX, reg);	/* set index register */
-  pv_set(char_out[1], vid_port + DATA, (val>>8) & BYTE);    /* high byte */
-  pv_set(char_out[2], vid_port + INDEX, reg + 1);	    /* again */
-  pv_set(char_out[3], vid_port + DATA, val&BYTE);	    /* low byte */
-  sys_voutb(char_out, 4);			/* do actual output */
+  pvb_pair_t char_out[8];
+  int n = 0;
+
+  if (cons->c_org != vid_org) {
+	vid_org = cons->c_org;
+	pv_set(char_out[n], vid_port + INDEX, VID_ORG);	      n++;
+	pv_set(char_out[n], vid_port + DATA, (vid_org>>8) & BYTE); n++;
+	pv_set(char_out[n], vid_port + INDEX, VID_ORG + 1);    n++;
+	pv_set(char_out[n], vid_port + DATA, vid_org & BYTE);	      n++;
+  }
+  if (cons->c_cur != vid_cur) {
+	vid_cur = cons->c_cur;
+	pv_set(char_out[n], vid_port + INDEX, CURSOR);	      n++;
+	pv_set(char_out[n], vid_port + DATA, (vid_cur>>8) & BYTE); n++;
+	pv_set(char_out[n], vid_port + INDEX, CURSOR + 1);     n++;
+	pv_set(char_out[n], vid_port + DATA, vid_cur & BYTE);	      n++;
+  }
+  if (n > 0) sys_voutb(char_out, n);		/* do actual output */
 }
 
 /*===========================================================================*
@@ -849,16 +997,22 @@ PUBLIC void scr_init(tty_t *tp)
   cons->c_limit = cons->c_start + page_size;
   cons->c_cur = cons->c_org = cons->c_start;
   cons->c_attr = cons->c_blank = BLANK_COLOR;
+  cons->c_shadow = shadow_mem + line * scr_size;
+  cons->c_top = 0;
+  mark_clean(cons);
 
   if (line != 0) {
         /* Clear the non-console vtys. */
-  	blank_color = BLANK_COLOR;
-	mem_vid_copy(BLANK_MEM, cons->c_start, scr_size);
+	blank_chars(cons, 0, 0, scr_size);
   } else {
-	int i, n;
-	/* Set the cursor of the console vty at the bottom. c_cur
-	 * is updated automatically later.
+	/* Start the shadow of the console vty with what the boot monitor
+	 * left on the screen.  Set the cursor at the bottom. c_cur is
+	 * updated automatically later.
 	 */
+	s = sys_vircopy(SELF, vid_index, (vir_bytes) 0, SELF, D,
+		(vir_bytes) cons->c_shadow, (vir_bytes) scr_size * sizeof(u16_t));
+	if (s != OK) blank_chars(cons, 0, 0, scr_size);
+	mark_dirty(cons, 0, scr_lines - 1);
 	scroll_screen(cons, SCROLL_UP);
 	cons->c_row = scr_lines - 1;
 	cons->c_column = 0;
@@ -882,25 +1036,24 @@ PUBLIC void do_new_kmess(message *m)
 {
 /* Notification for a new kernel message. */
   struct kmessages kmess;			/* kmessages structure */
-  static int prev_next = 0;			/* previous next seen */
-  int size, next;
-  int bytes;
-  int r;
+  static unsigned prev_next = 0;		/* previous next seen */
+  unsigned bytes, r;
 
   /* Try to get a fresh copy of the buffer with kernel messages. */
   sys_getkmessages(&kmess);
 
-  /* Print only the new part. Determine how many new bytes there are with 
-   * help of the current and previous 'next' index. Note that the kernel
-   * buffer is circular. This works fine if less then KMESS_BUF_SIZE bytes
-   * is new data; else we miss % KMESS_BUF_SIZE here.  
+  /* Print only the new part. The 'next' field is a free running sequence
+   * number, so the difference with the previous value is the number of new
+   * bytes. If more than KMESS_BUF_SIZE bytes are new, the oldest ones were
+   * overwritten before we got here; only the buffer contents can be shown.
    * Check for size being positive, the buffer might as well be emptied!
    */
   if (kmess.km_size > 0) {
-      bytes = ((kmess.km_next + KMESS_BUF_SIZE) - prev_next) % KMESS_BUF_SIZE;
-      r=prev_next;				/* start at previous old */ 
+      bytes = kmess.km_next - prev_next;
+      if (bytes > KMESS_BUF_SIZE) bytes = KMESS_BUF_SIZE;
+      r = kmess.km_next - bytes;		/* start at oldest new byte */
       while (bytes > 0) {			
-          putk( kmess.km_buf[(r%KMESS_BUF_SIZE)] );
+          putk( kmess.km_buf[r & (KMESS_BUF_SIZE-1)] );
           bytes --;
           r ++;
       }
@@ -955,7 +1108,7 @@ PRIVATE void putk(int c)
 	if (c == '\n') putk('\r');
 	out_char(&cons_table[0], (int) c);
   } else {
-	flush(&cons_table[0]);
+	render(&cons_table[0]);
   }
 }
 
@@ -988,25 +1141,34 @@ PUBLIC void cons_stop()
  *===========================================================================*/
 PRIVATE void cons_org0()
 {
-/* Scroll video memory back to put the origin at 0. */
+/* Put the origin back at 0 and redraw the screens from the shadows. */
   int cons_line;
   console_t *cons;
-  unsigned n;
 
   for (cons_line = 0; cons_line < nr_cons; cons_line++) {
 	cons = &cons_table[cons_line];
-	while (cons->c_org > cons->c_start) {
-		n = vid_size - scr_size;	/* amount of unused memory */
-		if (n > cons->c_org - cons->c_start)
-			n = cons->c_org - cons->c_start;
-		vid_vid_copy(cons->c_org, cons->c_org - n, scr_size);
-		cons->c_org -= n;
+	render(cons);
+	if (cons->c_org != cons->c_start) {
+		cons->c_org = cons->c_start;
+		mark_dirty(cons, 0, scr_lines - 1);
+		render(cons);
 	}
-	flush(cons);
   }
   select_console(ccurrent);
 }
 
+/*===========================================================================*
+ *				cons_render				     *
+ *===========================================================================*/
+PUBLIC void cons_render()
+{
+/* Show the output of this round of the TTY main loop on the screens. */
+  int cons_line;
+
+  for (cons_line = 0; cons_line < nr_cons; cons_line++)
+	render(&cons_table[cons_line]);
+}
+
 /*===========================================================================*
  *				select_console				     *
  *===========================================================================*/
@@ -1017,8 +1179,7 @@ PUBLIC void select_console(int cons_line)
   if (cons_line < 0 || cons_line >= nr_cons) return;
   ccurrent = cons_line;
   curcons = &cons_table[cons_line];
-  set_6845(VID_ORG, curcons->c_org);
-  set_6845(CURSOR, curcons->c_cur);
+  render(curcons);
 }
 
 /*===========================================================================*
@@ -146,7 +146,7 @@ PUBLIC void kbd_interrupt(message *m_ptr)
 	*ihead++ = scode;
 	if (ihead == ibuf + KB_IN_BYTES) ihead = ibuf;
 	icount++;
-	tty_table[ccurrent].tty_events = 1;
+	set_events(&tty_table[ccurrent]);
 	if (tty_table[ccurrent].tty_select_ops & SEL_RD) {
 		select_retry(&tty_table[ccurrent]);
 	}
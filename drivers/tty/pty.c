@@ -0,0 +1,737 @@
+/*	pty.c - pseudo terminal driver
+ *
+ * A pseudo terminal is a pair of devices.  The tty side, /dev/ttypX, is an
+ * ordinary terminal handled by tty.c.  The pty side, /dev/ptypX, is used by
+ * a program like a remote login server or a terminal multiplexer to play the
+ * part of the terminal hardware: what is written to the pty side is input
+ * for the tty side, and what is written to the tty side can be read from
+ * the pty side.
+ *
+ * Both directions go through a ring buffer of PTY_BUF_SIZE bytes, a power of
+ * two, so the head and tail can be free running counters that are masked to
+ * find a position.  Data is moved between a ring and a user process with one
+ * sys_vircopy() per contiguous piece of the ring.  If the line is in raw mode
+ * and a reader on the other side is waiting with nothing buffered, the data
+ * is copied from the writer to the reader directly, like a pipe would do.
+ *
+ * Select readiness of the pty side is reevaluated wherever its state changes,
+ * so it does not depend on a sweep over all lines.
+ */
+
+#include "../drivers.h"
+#include <termios.h>
+#include <signal.h>
+#include <minix/com.h>
+#include <minix/callnr.h>
+#include <sys/select.h>
+#include "tty.h"
+
+#if NR_PTYS > 0
+
+#define PTY_BUF_SIZE	2048	/* size of the rings, must be a power of 2 */
+#define PTY_BUF_MASK	(PTY_BUF_SIZE - 1)
+
+/* Number of bytes in a ring, and contiguous bytes or space from a counter. */
+#define ring_count(head, tail)	((head) - (tail))
+#define ring_piece(ptr)		(PTY_BUF_SIZE - ((ptr) & PTY_BUF_MASK))
+
+/* PTY bookkeeping structure, one per conversation. */
+typedef struct pty {
+  tty_t		*tty;		/* associated TTY structure */
+  char		state;		/* flags: busy, closed, ... */
+
+  /* Read call on /dev/ptypX. */
+  char		rdrepcode;	/* reply code, TASK_REPLY or REVIVE */
+  char		rdrevived;	/* set to 1 if revive callback is pending */
+  char		rdcaller;	/* process making the call (usually FS) */
+  char		rdproc;		/* process that wants to read from the pty */
+  vir_bytes	rdvir;		/* virtual address in readers address space */
+  int		rdleft;		/* # bytes yet to be read */
+  int		rdcum;		/* # bytes read so far */
+
+  /* Write call to /dev/ptypX. */
+  char		wrrepcode;	/* reply code, TASK_REPLY or REVIVE */
+  char		wrrevived;	/* set to 1 if revive callback is pending */
+  char		wrcaller;	/* process making the call (usually FS) */
+  char		wrproc;		/* process that wants to write to the pty */
+  vir_bytes	wrvir;		/* virtual address in writers address space */
+  int		wrleft;		/* # bytes yet to be written */
+  int		wrcum;		/* # bytes written so far */
+
+  /* Output ring, bytes going from the tty side to the pty reader. */
+  unsigned	ohead;		/* where the next byte goes */
+  unsigned	otail;		/* next byte for the pty reader */
+  char		obuf[PTY_BUF_SIZE];
+
+  /* Input ring, bytes going from the pty writer to the tty side. */
+  unsigned	ihead;		/* where the next byte goes */
+  unsigned	itail;		/* next byte for input processing */
+  char		ibuf[PTY_BUF_SIZE];
+
+  /* select() data. */
+  int		select_ops;	/* which operations are interesting */
+  int		select_proc;	/* which process wants notification */
+  int		select_ready_ops;	/* ready operations to report */
+} pty_t;
+
+#define PTY_ACTIVE	0x01	/* pty is open/active */
+#define TTY_CLOSED	0x02	/* tty side has closed down */
+#define PTY_CLOSED	0x04	/* pty side has closed down */
+
+PRIVATE pty_t pty_table[NR_PTYS];	/* PTY bookkeeping */
+
+FORWARD _PROTOTYPE( int pty_write, (tty_t *tp, int try)			);
+FORWARD _PROTOTYPE( void pty_echo, (tty_t *tp, int c)			);
+FORWARD _PROTOTYPE( void pty_start, (pty_t *pp)				);
+FORWARD _PROTOTYPE( void pty_finish, (pty_t *pp)			);
+FORWARD _PROTOTYPE( int pty_read, (tty_t *tp, int try)			);
+FORWARD _PROTOTYPE( int pty_direct, (tty_t *tp)				);
+FORWARD _PROTOTYPE( void pty_wrdone, (pty_t *pp)			);
+FORWARD _PROTOTYPE( int pty_close, (tty_t *tp, int try)			);
+FORWARD _PROTOTYPE( int pty_icancel, (tty_t *tp, int try)		);
+FORWARD _PROTOTYPE( int pty_ocancel, (tty_t *tp, int try)		);
+FORWARD _PROTOTYPE( int pty_select, (tty_t *tp, message *m)		);
+FORWARD _PROTOTYPE( int select_try_pty, (tty_t *tp, int ops)		);
+
+/*===========================================================================*
+ *				do_pty					     *
+ *===========================================================================*/
+/* tty struct of the conversation */
+/* pointer to message sent to the task */
+PUBLIC void do_pty(tty_t *tp, message *m_ptr)
+{
+/* Perform an open/close/read/write call on a /dev/ptypX device. */
+  pty_t *pp = tp->tty_priv;
+  int r;
+  phys_bytes phys_addr;
+
+  switch (m_ptr->m_type) {
+    case DEV_READ:
+	/* Check, store information on the reader, do I/O. */
+	if (pp->state & TTY_CLOSED) {
+		r = 0;
+		break;
+	}
+	if (pp->rdleft != 0) {
+		r = EIO;
+		break;
+	}
+	if (m_ptr->COUNT <= 0) {
+		r = EINVAL;
+		break;
+	}
+	if (sys_umap(m_ptr->PROC_NR, D, (vir_bytes) m_ptr->ADDRESS,
+				m_ptr->COUNT, &phys_addr) != OK) {
+		r = EFAULT;
+		break;
+	}
+	pp->rdrepcode = TASK_REPLY;
+	pp->rdcaller = m_ptr->m_source;
+	pp->rdproc = m_ptr->PROC_NR;
+	pp->rdvir = (vir_bytes) m_ptr->ADDRESS;
+	pp->rdleft = m_ptr->COUNT;
+	pty_start(pp);
+	handle_events(tp);
+	if (pp->rdleft == 0) return;			/* already done */
+
+	if (m_ptr->TTY_FLAGS & O_NONBLOCK) {
+		r = EAGAIN;				/* don't suspend */
+		pp->rdleft = pp->rdcum = 0;
+	} else {
+		r = SUSPEND;				/* do suspend */
+		pp->rdrepcode = REVIVE;
+	}
+	break;
+
+    case DEV_WRITE:
+	/* Check, store information on the writer, do I/O. */
+	if (pp->state & TTY_CLOSED) {
+		r = EIO;
+		break;
+	}
+	if (pp->wrleft != 0) {
+		r = EIO;
+		break;
+	}
+	if (m_ptr->COUNT <= 0) {
+		r = EINVAL;
+		break;
+	}
+	if (sys_umap(m_ptr->PROC_NR, D, (vir_bytes) m_ptr->ADDRESS,
+				m_ptr->COUNT, &phys_addr) != OK) {
+		r = EFAULT;
+		break;
+	}
+	pp->wrrepcode = TASK_REPLY;
+	pp->wrcaller = m_ptr->m_source;
+	pp->wrproc = m_ptr->PROC_NR;
+	pp->wrvir = (vir_bytes) m_ptr->ADDRESS;
+	pp->wrleft = m_ptr->COUNT;
+	handle_events(tp);
+	if (pp->wrleft == 0) return;			/* already done */
+
+	if (m_ptr->TTY_FLAGS & O_NONBLOCK) {		/* don't suspend */
+		r = pp->wrcum > 0 ? pp->wrcum : EAGAIN;
+		pp->wrleft = pp->wrcum = 0;
+	} else {
+		pp->wrrepcode = REVIVE;			/* do suspend */
+		r = SUSPEND;
+	}
+	break;
+
+    case DEV_OPEN:
+	r = pp->state != 0 ? EIO : OK;
+	pp->state |= PTY_ACTIVE;
+	pp->rdcum = 0;
+	pp->wrcum = 0;
+	break;
+
+    case DEV_CLOSE:
+	if (pp->state & TTY_CLOSED) {
+		/* Both sides closed; leave nothing for the next pair. */
+		pp->state = 0;
+		pp->ohead = pp->otail = 0;
+	} else {
+		pp->state |= PTY_CLOSED;
+		sigchar(tp, SIGHUP);
+	}
+	pp->ihead = pp->itail = 0;
+	pp->select_ops = 0;
+	r = OK;
+	break;
+
+    case DEV_SELECT:
+	r = pty_select(tp, m_ptr);
+	break;
+
+    case CANCEL:
+	if (m_ptr->PROC_NR == pp->rdproc) {
+		/* Cancel a read from a PTY. */
+		pp->rdleft = pp->rdcum = 0;
+		pp->rdrevived = 0;
+	}
+	if (m_ptr->PROC_NR == pp->wrproc) {
+		/* Cancel a write to a PTY. */
+		pp->wrleft = pp->wrcum = 0;
+		pp->wrrevived = 0;
+	}
+	r = EINTR;
+	break;
+
+    default:
+	r = EINVAL;
+  }
+  tty_reply(TASK_REPLY, m_ptr->m_source, m_ptr->PROC_NR, r);
+}
+
+/*===========================================================================*
+ *				pty_write				     *
+ *===========================================================================*/
+/* tty struct of the conversation */
+/* only check if output is possible */
+PRIVATE int pty_write(tty_t *tp, int try)
+{
+/* (*dev_write)() routine for PTYs.  Transfer bytes from the writer on
+ * /dev/ttypX to the output ring, or straight to the reader of /dev/ptypX.
+ */
+  pty_t *pp = tp->tty_priv;
+  int count, ocount, s;
+  char *ohead;
+
+  /* PTY closed down? */
+  if (pp->state & PTY_CLOSED) {
+	if (try) return 1;
+	if (tp->tty_outleft > 0) {
+		tty_reply(tp->tty_outrepcode, tp->tty_outcaller,
+						tp->tty_outproc, EIO);
+		tp->tty_outleft = tp->tty_outcum = 0;
+	}
+	return 0;
+  }
+
+  if (try) return(ring_count(pp->ohead, pp->otail) < PTY_BUF_SIZE);
+
+  /* Without output processing, a waiting reader can be served directly if
+   * nothing is queued before the writer's data.
+   */
+  if (!(tp->tty_termios.c_oflag & OPOST) && !tp->tty_inhibited
+	&& pp->rdleft > 0 && ring_count(pp->ohead, pp->otail) == 0
+	&& tp->tty_outleft > 0) {
+	count = tp->tty_outleft;
+	if (count > pp->rdleft) count = pp->rdleft;
+	if ((s = sys_vircopy(tp->tty_outproc, D, tp->tty_out_vir,
+		pp->rdproc, D, pp->rdvir, (vir_bytes) count)) != OK) {
+		printf("pty tty%d: copy failed: error %d\n",
+					tp->tty_index, s);
+	} else {
+		pp->rdvir += count;
+		pp->rdcum += count;
+		pp->rdleft -= count;
+		tp->tty_out_vir += count;
+		tp->tty_outcum += count;
+		tp->tty_outleft -= count;
+		tp->tty_reprint = TRUE;
+	}
+  }
+
+  /* While there is something to do, copy to the output ring one piece of
+   * contiguous space at a time.
+   */
+  while (tp->tty_outleft > 0 && !tp->tty_inhibited) {
+	ocount = PTY_BUF_SIZE - ring_count(pp->ohead, pp->otail);
+	count = ring_piece(pp->ohead);
+	if (count > ocount) count = ocount;
+	if (count > tp->tty_outleft) count = tp->tty_outleft;
+	if (count == 0) break;
+	ohead = pp->obuf + (pp->ohead & PTY_BUF_MASK);
+
+	/* Copy from user space to the PTY output ring. */
+	if ((s = sys_vircopy(tp->tty_outproc, D, tp->tty_out_vir,
+		SELF, D, (vir_bytes) ohead, (vir_bytes) count)) != OK) {
+		printf("pty tty%d: copy failed: error %d\n",
+					tp->tty_index, s);
+		break;
+	}
+
+	/* Perform output processing on the output ring. */
+	out_process(tp, pp->obuf, ohead, bufend(pp->obuf), &count, &ocount);
+	if (count == 0) break;
+
+	/* Assume echoing messed up by output. */
+	tp->tty_reprint = TRUE;
+
+	/* Bookkeeping. */
+	pp->ohead += ocount;
+	pty_start(pp);
+	tp->tty_out_vir += count;
+	tp->tty_outcum += count;
+	tp->tty_outleft -= count;
+  }
+
+  if (tp->tty_outleft == 0 && tp->tty_outcum > 0) {
+	/* Output is finished, reply to the writer. */
+	tty_reply(tp->tty_outrepcode, tp->tty_outcaller,
+				tp->tty_outproc, tp->tty_outcum);
+	tp->tty_outcum = 0;
+  }
+  pty_finish(pp);
+  return 1;
+}
+
+/*===========================================================================*
+ *				pty_echo				     *
+ *===========================================================================*/
+/* tty struct of the conversation */
+/* character to echo */
+PRIVATE void pty_echo(tty_t *tp, int c)
+{
+/* Echo one character.  (Like pty_write, but only one character, optionally.) */
+  pty_t *pp = tp->tty_priv;
+  int count, ocount;
+  char *ohead;
+
+  ocount = PTY_BUF_SIZE - ring_count(pp->ohead, pp->otail);
+  if (ocount == 0) return;		/* output ring full */
+  count = 1;
+  ohead = pp->obuf + (pp->ohead & PTY_BUF_MASK);
+  *ohead = c;				/* add one character */
+
+  out_process(tp, pp->obuf, ohead, bufend(pp->obuf), &count, &ocount);
+  if (count == 0) return;
+
+  pp->ohead += ocount;
+  pty_start(pp);
+}
+
+/*===========================================================================*
+ *				pty_start				     *
+ *===========================================================================*/
+PRIVATE void pty_start(pty_t *pp)
+{
+/* Transfer bytes written to the output ring to the PTY reader, at most two
+ * copies, because the ring wraps only once.  Tell a selecting process that
+ * there is something to read if there is no reader.
+ */
+  int count, s;
+
+  while (pp->rdleft > 0) {
+	count = ring_piece(pp->otail);
+	if (count > ring_count(pp->ohead, pp->otail))
+		count = ring_count(pp->ohead, pp->otail);
+	if (count > pp->rdleft) count = pp->rdleft;
+	if (count == 0) break;
+
+	/* Copy from the output ring to the readers address space. */
+	if ((s = sys_vircopy(SELF, D,
+		(vir_bytes) (pp->obuf + (pp->otail & PTY_BUF_MASK)),
+		pp->rdproc, D, pp->rdvir, (vir_bytes) count)) != OK) {
+		printf("pty tty%d: copy failed: error %d\n",
+					pp->tty->tty_index, s);
+		break;
+	}
+
+	/* Bookkeeping. */
+	pp->otail += count;
+	pp->rdvir += count;
+	pp->rdcum += count;
+	pp->rdleft -= count;
+  }
+  if (pp->select_ops & SEL_RD) select_retry_pty(pp->tty);
+}
+
+/*===========================================================================*
+ *				pty_finish				     *
+ *===========================================================================*/
+PRIVATE void pty_finish(pty_t *pp)
+{
+/* Finish the read request of a PTY reader if there is at least one byte
+ * transferred.
+ */
+  if (pp->rdcum > 0 && !pp->rdrevived) {
+	if (pp->rdrepcode == REVIVE) {
+		notify(pp->rdcaller);
+		pp->rdrevived = 1;
+	} else {
+		tty_reply(pp->rdrepcode, pp->rdcaller, pp->rdproc, pp->rdcum);
+		pp->rdleft = pp->rdcum = 0;
+	}
+  }
+}
+
+/*===========================================================================*
+ *				pty_read				     *
+ *===========================================================================*/
+/* tty struct of the conversation */
+/* only check if input is available */
+PRIVATE int pty_read(tty_t *tp, int try)
+{
+/* Offer bytes from the PTY writer for input on the TTY.  The bytes are
+ * fetched into the input ring one contiguous piece at a time, and input
+ * processing is done on whole pieces too.  Bytes the TTY input queue has
+ * no room for stay in the ring.
+ */
+  pty_t *pp = tp->tty_priv;
+  int count, done, s;
+
+  if (pp->state & PTY_CLOSED) {
+	if (try) return 1;
+	if (tp->tty_inleft > 0) {
+		tty_reply(tp->tty_inrepcode, tp->tty_incaller, tp->tty_inproc,
+							tp->tty_incum);
+		tp->tty_inleft = tp->tty_incum = 0;
+	}
+	return 1;
+  }
+
+  if (try) {
+	return(pp->wrleft > 0 || ring_count(pp->ihead, pp->itail) > 0);
+  }
+
+  /* A raw reader waiting on an empty line gets the data at once. */
+  if (pty_direct(tp)) return 1;
+
+  do {
+	done = 0;
+
+	/* Fill the input ring from the writer. */
+	count = PTY_BUF_SIZE - ring_count(pp->ihead, pp->itail);
+	if (count > ring_piece(pp->ihead)) count = ring_piece(pp->ihead);
+	if (count > pp->wrleft) count = pp->wrleft;
+	if (count > 0) {
+		if ((s = sys_vircopy(pp->wrproc, D, pp->wrvir, SELF, D,
+			(vir_bytes) (pp->ibuf + (pp->ihead & PTY_BUF_MASK)),
+			(vir_bytes) count)) != OK) {
+			printf("pty tty%d: copy failed: error %d\n",
+						tp->tty_index, s);
+			break;
+		}
+		pp->ihead += count;
+		pp->wrvir += count;
+		pp->wrcum += count;
+		pp->wrleft -= count;
+		if (pp->wrleft == 0) pty_wrdone(pp);
+		done += count;
+	}
+
+	/* Input processing on what the ring holds. */
+	count = ring_piece(pp->itail);
+	if (count > ring_count(pp->ihead, pp->itail))
+		count = ring_count(pp->ihead, pp->itail);
+	if (count > 0) {
+		count = in_process(tp, pp->ibuf + (pp->itail & PTY_BUF_MASK),
+								count);
+		pp->itail += count;
+		done += count;
+	}
+  } while (done > 0);
+
+  /* The tty side may be selected for reading, and the writer for writing. */
+  if (tp->tty_select_ops & SEL_RD) select_retry(tp);
+  if (pp->select_ops & SEL_WR) select_retry_pty(tp);
+  return 1;
+}
+
+/*===========================================================================*
+ *				pty_direct				     *
+ *===========================================================================*/
+PRIVATE int pty_direct(tty_t *tp)
+{
+/* If the tty side is in raw mode without any input processing or timers, its
+ * reader is waiting, and nothing is queued before the pty writer's data, then
+ * copy straight from the pty writer to the tty reader.  Return 1 if this was
+ * possible.
+ */
+  pty_t *pp = tp->tty_priv;
+  int count, s;
+
+  if (!tp->tty_passthru || tp->tty_termios.c_cc[VTIME] != 0
+	|| tp->tty_inleft == 0 || tp->tty_incount > 0
+	|| pp->wrleft == 0 || ring_count(pp->ihead, pp->itail) > 0) {
+	return 0;
+  }
+
+  count = pp->wrleft;
+  if (count > tp->tty_inleft) count = tp->tty_inleft;
+  if ((s = sys_vircopy(pp->wrproc, D, pp->wrvir,
+		tp->tty_inproc, D, tp->tty_in_vir, (vir_bytes) count)) != OK) {
+	printf("pty tty%d: copy failed: error %d\n", tp->tty_index, s);
+	return 0;
+  }
+
+  /* TTY reader bookkeeping.  handle_events() replies to a reader that still
+   * wants more once it has MIN characters, a satisfied reader is done here.
+   */
+  tp->tty_in_vir += count;
+  tp->tty_incum += count;
+  if ((tp->tty_inleft -= count) == 0) {
+	if (tp->tty_inrepcode == REVIVE) {
+		notify(tp->tty_incaller);
+		tp->tty_inrevived = 1;
+	} else {
+		tty_reply(tp->tty_inrepcode, tp->tty_incaller,
+				tp->tty_inproc, tp->tty_incum);
+		tp->tty_incum = 0;
+	}
+  }
+
+  /* PTY writer bookkeeping. */
+  pp->wrvir += count;
+  pp->wrcum += count;
+  if ((pp->wrleft -= count) == 0) pty_wrdone(pp);
+  if (pp->select_ops & SEL_WR) select_retry_pty(tp);
+  return 1;
+}
+
+/*===========================================================================*
+ *				pty_wrdone				     *
+ *===========================================================================*/
+PRIVATE void pty_wrdone(pty_t *pp)
+{
+/* All bytes of the PTY writer have been accepted, reply to it. */
+  if (pp->wrrepcode == REVIVE) {
+	notify(pp->wrcaller);
+	pp->wrrevived = 1;
+  } else {
+	tty_reply(pp->wrrepcode, pp->wrcaller, pp->wrproc, pp->wrcum);
+	pp->wrcum = 0;
+  }
+}
+
+/*===========================================================================*
+ *				pty_close				     *
+ *===========================================================================*/
+PRIVATE int pty_close(tty_t *tp, int try)
+{
+/* The tty side has closed, so shut down the pty side. */
+  pty_t *pp = tp->tty_priv;
+
+  if (!(pp->state & PTY_ACTIVE)) return 0;
+
+  /* A suspended reader or writer on the pty side must be revived. */
+  if (pp->rdleft > 0 && pp->rdrepcode == REVIVE) {
+	notify(pp->rdcaller);
+	pp->rdrevived = 1;
+  }
+  if (pp->wrleft > 0 && pp->wrrepcode == REVIVE) {
+	notify(pp->wrcaller);
+	pp->wrrevived = 1;
+  }
+
+  if (pp->state & PTY_CLOSED) {
+	/* Both sides closed; leave nothing for the next pair. */
+	pp->state = 0;
+	pp->ohead = pp->otail = 0;
+	pp->ihead = pp->itail = 0;
+  } else {
+	pp->state |= TTY_CLOSED;
+  }
+  if (pp->select_ops) select_retry_pty(tp);
+  return 0;
+}
+
+/*===========================================================================*
+ *				pty_icancel				     *
+ *===========================================================================*/
+PRIVATE int pty_icancel(tty_t *tp, int try)
+{
+/* Discard waiting input. */
+  pty_t *pp = tp->tty_priv;
+
+  pp->ihead = pp->itail = 0;
+  if (pp->wrleft > 0) {
+	pp->wrcum += pp->wrleft;
+	pp->wrleft = 0;
+	pty_wrdone(pp);
+  }
+  return 0;
+}
+
+/*===========================================================================*
+ *				pty_ocancel				     *
+ *===========================================================================*/
+PRIVATE int pty_ocancel(tty_t *tp, int try)
+{
+/* Drain the output ring. */
+  pty_t *pp = tp->tty_priv;
+
+  pp->otail = pp->ohead;
+  return 0;
+}
+
+/*===========================================================================*
+ *				pty_init				     *
+ *===========================================================================*/
+PUBLIC void pty_init(tty_t *tp)
+{
+  pty_t *pp;
+  int line;
+
+  /* Associate PTY and TTY structures. */
+  line = tp - &tty_table[NR_CONS + NR_RS_LINES];
+  pp = tp->tty_priv = &pty_table[line];
+  pp->tty = tp;
+  pp->select_ops = 0;
+
+  /* Set up the rings. */
+  pp->ohead = pp->otail = 0;
+  pp->ihead = pp->itail = 0;
+
+  /* Fill in TTY function hooks. */
+  tp->tty_devread = pty_read;
+  tp->tty_devwrite = pty_write;
+  tp->tty_echo = pty_echo;
+  tp->tty_icancel = pty_icancel;
+  tp->tty_ocancel = pty_ocancel;
+  tp->tty_close = pty_close;
+  tp->tty_select_ops = 0;
+}
+
+/*===========================================================================*
+ *				pty_status				     *
+ *===========================================================================*/
+PUBLIC int pty_status(message *m_ptr)
+{
+/* FS wants to know about finished or selected I/O on the pty side.  Return
+ * 1 and fill in the reply message if an event is found.
+ */
+  int i;
+  pty_t *pp;
+
+  for (i = 0, pp = pty_table; i < NR_PTYS; i++, pp++) {
+	if ((pp->rdrevived || ((pp->state & TTY_CLOSED) && pp->rdleft > 0))
+		&& pp->rdcaller == m_ptr->m_source) {
+		m_ptr->m_type = DEV_REVIVE;
+		m_ptr->REP_PROC_NR = pp->rdproc;
+		m_ptr->REP_STATUS = pp->rdcum;
+
+		pp->rdleft = pp->rdcum = 0;
+		pp->rdrevived = 0;
+		return 1;
+	}
+
+	if ((pp->wrrevived || ((pp->state & TTY_CLOSED) && pp->wrleft > 0))
+		&& pp->wrcaller == m_ptr->m_source) {
+		m_ptr->m_type = DEV_REVIVE;
+		m_ptr->REP_PROC_NR = pp->wrproc;
+		m_ptr->REP_STATUS = pp->wrcum > 0 ? pp->wrcum : EIO;
+
+		pp->wrleft = pp->wrcum = 0;
+		pp->wrrevived = 0;
+		return 1;
+	}
+
+	if (pp->select_ready_ops && pp->select_proc == m_ptr->m_source) {
+		m_ptr->m_type = DEV_IO_READY;
+		m_ptr->DEV_MINOR = PTYPX_MINOR + i;
+		m_ptr->DEV_SEL_OPS = pp->select_ready_ops;
+		pp->select_ready_ops = 0;
+		return 1;
+	}
+  }
+  return 0;
+}
+
+/*===========================================================================*
+ *				select_try_pty				     *
+ *===========================================================================*/
+PRIVATE int select_try_pty(tty_t *tp, int ops)
+{
+/* Find out which of the operations would not block on the pty side. */
+  pty_t *pp = tp->tty_priv;
+  int r = 0;
+
+  if (ops & SEL_WR) {
+	/* Write won't block on error, or if there is room in the ring. */
+	if (pp->state & TTY_CLOSED) r |= SEL_WR;
+	else if (pp->wrleft == 0
+		&& ring_count(pp->ihead, pp->itail) < PTY_BUF_SIZE) r |= SEL_WR;
+  }
+
+  if (ops & SEL_RD) {
+	/* Read won't block on error. */
+	if (pp->state & TTY_CLOSED) r |= SEL_RD;
+	else if (pp->rdleft != 0 || pp->rdcum != 0) r |= SEL_RD;
+	else if (ring_count(pp->ohead, pp->otail) > 0) r |= SEL_RD;
+  }
+
+  return r;
+}
+
+/*===========================================================================*
+ *				select_retry_pty			     *
+ *===========================================================================*/
+PUBLIC void select_retry_pty(tty_t *tp)
+{
+/* See if the pty side of a pty is ready to return a select. */
+  pty_t *pp = tp->tty_priv;
+  int r;
+
+  if (pp->select_ops && (r = select_try_pty(tp, pp->select_ops))) {
+	pp->select_ops &= ~r;
+	pp->select_ready_ops |= r;
+	notify(pp->select_proc);
+  }
+}
+
+/*===========================================================================*
+ *				pty_select				     *
+ *===========================================================================*/
+PRIVATE int pty_select(tty_t *tp, message *m)
+{
+  pty_t *pp = tp->tty_priv;
+  int ops, ready_ops = 0, watch;
+
+  ops = m->PROC_NR & (SEL_RD|SEL_WR|SEL_ERR);
+  watch = (m->PROC_NR & SEL_NOTIFY) ? 1 : 0;
+
+  ready_ops = select_try_pty(tp, ops);
+
+  if (!ready_ops && ops && watch) {
+	pp->select_ops |= ops;
+	pp->select_proc = m->m_source;
+  }
+
+  return ready_ops;
+}
+
+#endif /* NR_PTYS > 0 */
@@ -108,6 +108,7 @@ FORWARD _PROTOTYPE( void do_write, (tty_t *tp, message *m_ptr)		);
 FORWARD _PROTOTYPE( void do_select, (tty_t *tp, message *m_ptr)		);
 FORWARD _PROTOTYPE( void do_status, (message *m_ptr)			);
 FORWARD _PROTOTYPE( void in_transfer, (tty_t *tp)			);
+FORWARD _PROTOTYPE( int in_passthru, (tty_t *tp, char *buf, int count)	);
 FORWARD _PROTOTYPE( int tty_echo, (tty_t *tp, int ch)			);
 FORWARD _PROTOTYPE( void rawecho, (tty_t *tp, int ch)			);
 FORWARD _PROTOTYPE( int back_over, (tty_t *tp)				);
@@ -135,6 +136,15 @@ PUBLIC timer_t *tty_timers;		/* queue of TTY timers */
 PUBLIC clock_t tty_next_timeout;	/* time that the next alarm is due */
 PUBLIC struct machine machine;		/* kernel environment variables */
 
+/* Queue of lines with events, in the order the events were signalled. */
+PRIVATE tty_t *ev_head;			/* first line to be handled */
+PRIVATE tty_t *ev_tail;			/* last line to be handled */
+
+/* Characters on their way from an input queue to a reader.  The queue can
+ * hold no more than this, so a reader always gets its data in one copy.
+ */
+PRIVATE char in_xfer[TTY_IN_BYTES];
+
 /*===========================================================================*
  *				tty_task				     *
  *===========================================================================*/
@@ -164,11 +174,18 @@ PUBLIC void main(void)
 
   while (TRUE) {
 
-	/* Check for and handle any events on any of the ttys. */
-	for (tp = FIRST_TTY; tp < END_TTY; tp++) {
+	/* Handle the events on the ttys that signalled them.  Lines that
+	 * signal events while this is going on are queued at the end.
+	 */
+	while ((tp = ev_head) != NULL) {
+		ev_head = tp->tty_nextev;
+		tp->tty_queued = 0;
 		if (tp->tty_events) handle_events(tp);
 	}
 
+	/* Show what has been written to the consoles. */
+	cons_render();
+
 	/* Get a request message. */
 	receive(ANY, &tty_mess);
 
@@ -574,7 +591,7 @@ PRIVATE void do_ioctl(register tty_t *tp, message *m_ptr)
 	    case TCOOFF:
 	    case TCOON:
 		tp->tty_inhibited = (param.i == TCOOFF);
-		tp->tty_events = 1;
+		set_events(tp);
 		break;
 	    case TCIOFF:
 		(*tp->tty_echo)(tp, tp->tty_termios.c_cc[VSTOP]);
@@ -701,7 +718,7 @@ PRIVATE void do_cancel(register tty_t *tp, message *m_ptr)
 	/* Process was waiting for output to drain. */
 	tp->tty_ioreq = 0;
   }
-  tp->tty_events = 1;
+  set_events(tp);
   tty_reply(TASK_REPLY, m_ptr->m_source, proc_nr, EINTR);
 }
 
@@ -763,13 +780,15 @@ PUBLIC void handle_events(tty_t *tp)
  * to avoid swamping the TTY task.  Messages may be overwritten when the
  * lines are fast or when there are races between different lines, input
  * and output, because MINIX only provides single buffering for interrupt
- * messages (in proc.c).  This is handled by explicitly checking each line
- * for fresh input and completed output on each interrupt.
+ * messages (in proc.c).  This is handled by the interrupt handlers, which
+ * call set_events() for every line that has fresh input or completed output,
+ * so only those lines are checked.
  */
   char *buf;
   unsigned count;
   int status;
 
+  tp->tty_hecount++;
   do {
 	tp->tty_events = 0;
 
@@ -805,6 +824,26 @@ PUBLIC void handle_events(tty_t *tp)
 #endif
 }
 
+/*===========================================================================*
+ *				set_events				     *
+ *===========================================================================*/
+/* TTY that has work to do. */
+PUBLIC void set_events(register tty_t *tp)
+{
+/* Tell the main loop that a line has events to handle.  The line is put on
+ * the event queue if it isn't already there, so the main loop doesn't have
+ * to look at all lines to find the few that need attention.
+ */
+  tp->tty_events = 1;
+  tp->tty_evcount++;
+  if (tp->tty_queued) return;
+
+  tp->tty_queued = 1;
+  tp->tty_nextev = NULL;
+  if (ev_head == NULL) ev_head = tp; else ev_tail->tty_nextev = tp;
+  ev_tail = tp;
+}
+
 /*===========================================================================*
  *				in_transfer				     *
  *===========================================================================*/
@@ -815,7 +854,7 @@ PRIVATE void in_transfer(register tty_t *tp)
 
   int ch;
   int count;
-  char buf[64], *bp;
+  char *bp;
 
   /* Force read to succeed if the line is hung up, looks like EOF to reader. */
   if (tp->tty_termios.c_ospeed == B0) tp->tty_min = 0;
@@ -823,23 +862,17 @@ PRIVATE void in_transfer(register tty_t *tp)
   /* Anything to do? */
   if (tp->tty_inleft == 0 || tp->tty_eotct < tp->tty_min) return;
 
-  bp = buf;
+  /* Gather the characters for the reader in in_xfer[], it can hold all of
+   * the input queue.
+   */
+  bp = in_xfer;
   while (tp->tty_inleft > 0 && tp->tty_eotct > 0) {
 	ch = *tp->tty_intail;
 
 	if (!(ch & IN_EOF)) {
 		/* One character to be delivered to the user. */
-		*bp = ch & IN_CHAR;
+		*bp++ = ch & IN_CHAR;
 		tp->tty_inleft--;
-		if (++bp == bufend(buf)) {
-			/* Temp buffer full, copy to user space. */
-			sys_vircopy(SELF, D, (vir_bytes) buf, 
-				tp->tty_inproc, D, tp->tty_in_vir,
-				(vir_bytes) buflen(buf));
-			tp->tty_in_vir += buflen(buf);
-			tp->tty_incum += buflen(buf);
-			bp = buf;
-		}
 	}
 
 	/* Remove the character from the input queue. */
@@ -853,10 +886,10 @@ PRIVATE void in_transfer(register tty_t *tp)
 	}
   }
 
-  if (bp > buf) {
-	/* Leftover characters in the buffer. */
-	count = bp - buf;
-	sys_vircopy(SELF, D, (vir_bytes) buf, 
+  if (bp > in_xfer) {
+	/* Copy the characters to user space in one go. */
+	count = bp - in_xfer;
+	sys_vircopy(SELF, D, (vir_bytes) in_xfer, 
 		tp->tty_inproc, D, tp->tty_in_vir, (vir_bytes) count);
 	tp->tty_in_vir += count;
 	tp->tty_incum += count;
@@ -891,6 +924,11 @@ PUBLIC int in_process(register tty_t *tp, char *buf, int count)
   int timeset = FALSE;
   static unsigned char csize_mask[] = { 0x1F, 0x3F, 0x7F, 0xFF };
 
+  /* Without any input processing enabled, the characters can be queued
+   * without looking at them.
+   */
+  if (tp->tty_passthru) return(in_passthru(tp, buf, count));
+
   for (ct = 0; ct < count; ct++) {
 	/* Take one character. */
 	ch = *buf++ & BYTE;
@@ -973,7 +1011,7 @@ PUBLIC int in_process(register tty_t *tp, char *buf, int count)
 		/* Output stops on STOP (^S). */
 		if (ch == tp->tty_termios.c_cc[VSTOP]) {
 			tp->tty_inhibited = STOPPED;
-			tp->tty_events = 1;
+			set_events(tp);
 			continue;
 		}
 
@@ -982,7 +1020,7 @@ PUBLIC int in_process(register tty_t *tp, char *buf, int count)
 			if (ch == tp->tty_termios.c_cc[VSTART]
 					|| (tp->tty_termios.c_iflag & IXANY)) {
 				tp->tty_inhibited = RUNNING;
-				tp->tty_events = 1;
+				set_events(tp);
 				if (ch == tp->tty_termios.c_cc[VSTART])
 					continue;
 			}
@@ -1036,6 +1074,57 @@ PUBLIC int in_process(register tty_t *tp, char *buf, int count)
   return ct;
 }
 
+/*===========================================================================*
+ *				in_passthru				     *
+ *===========================================================================*/
+/* terminal on which characters have arrived */
+/* buffer with input characters */
+/* number of input characters */
+PRIVATE int in_passthru(register tty_t *tp, char *buf, int count)
+{
+/* Fast path of in_process() for a line in raw mode without special input
+ * characters, echoing, signals or character mapping, as set up by file
+ * transfer programs.  Every character is a "line break" that is queued as
+ * is, so copy runs of them into the input queue without any tests.  Return
+ * the number of characters queued.
+ */
+  register u16_t *head;
+  register int n;
+  int ct, space;
+
+  /* Start an inter-byte timer? */
+  if (count > 0 && tp->tty_termios.c_cc[VMIN] > 0
+				&& tp->tty_termios.c_cc[VTIME] > 0) {
+	settimer(tp, TRUE);
+  }
+
+  ct = 0;
+  while (ct < count) {
+	/* Is there space in the input queue?  Keep the rest if not. */
+	space = buflen(tp->tty_inbuf) - tp->tty_incount;
+	if (space == 0) break;
+
+	/* Copy up to the end of the input queue or the input. */
+	n = bufend(tp->tty_inbuf) - tp->tty_inhead;
+	if (n > space) n = space;
+	if (n > count - ct) n = count - ct;
+	ct += n;
+	tp->tty_incount += n;
+	tp->tty_eotct += n;
+	head = tp->tty_inhead;
+	while (n > 0) {
+		*head++ = (*buf++ & BYTE) | IN_EOT;
+		n--;
+	}
+	if (head == bufend(tp->tty_inbuf)) head = tp->tty_inbuf;
+	tp->tty_inhead = head;
+
+	/* Try to finish input if the queue threatens to overflow. */
+	if (tp->tty_incount == buflen(tp->tty_inbuf)) in_transfer(tp);
+  }
+  return ct;
+}
+
 /*===========================================================================*
  *				echo					     *
  *===========================================================================*/
@@ -1308,6 +1397,12 @@ PRIVATE void setattr(tty_t *tp)
 	}
   }
 
+  /* Can input be queued without any processing? */
+  tp->tty_passthru = !(tp->tty_termios.c_iflag
+				& (ISTRIP|IGNCR|ICRNL|INLCR|IXON))
+		&& !(tp->tty_termios.c_lflag
+				& (ICANON|IEXTEN|ISIG|ECHO|ECHONL));
+
   /* Inspect MIN and TIME. */
   settimer(tp, FALSE);
   if (tp->tty_termios.c_lflag & ICANON) {
@@ -1325,7 +1420,7 @@ PRIVATE void setattr(tty_t *tp)
   if (!(tp->tty_termios.c_iflag & IXON)) {
 	/* No start/stop output control, so don't leave output inhibited. */
 	tp->tty_inhibited = RUNNING;
-	tp->tty_events = 1;
+	set_events(tp);
   }
 
   /* Setting the output speed to zero hangs up the phone. */
@@ -1378,7 +1473,7 @@ PUBLIC void sigchar(register tty_t *tp, int sig)
 	tp->tty_intail = tp->tty_inhead;
 	(*tp->tty_ocancel)(tp, 0);			/* kill all output */
 	tp->tty_inhibited = RUNNING;
-	tp->tty_events = 1;
+	set_events(tp);
   }
 }
 
@@ -1440,7 +1535,7 @@ PRIVATE void tty_timed_out(timer_t *tp)
   tty_t *tty_ptr;
   tty_ptr = &tty_table[tmr_arg(tp)->ta_int];
   tty_ptr->tty_min = 0;			/* force read to succeed */
-  tty_ptr->tty_events = 1;		
+  set_events(tty_ptr);
 }
 
 /*===========================================================================*
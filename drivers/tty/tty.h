@@ -11,7 +11,7 @@
 
 #define LINEWRAP	   1	/* console.c - wrap lines at column 80 */
 
-#define TTY_IN_BYTES     256	/* tty input queue size */
+#define TTY_IN_BYTES    1024	/* tty input queue size */
 #define TAB_SIZE           8	/* distance between tab stops */
 #define TAB_MASK           7	/* mask to compute a tab stop position */
 
@@ -28,6 +28,10 @@ typedef struct tty {
   int tty_events;		/* set when TTY should inspect this line */
   int tty_index;		/* index into TTY table */
   int tty_minor;		/* device minor number */
+  char tty_queued;		/* 1 when on the queue of lines with events */
+  struct tty *tty_nextev;	/* next line on the queue of lines with events */
+  unsigned long tty_evcount;	/* # times events were signalled */
+  unsigned long tty_hecount;	/* # times events were handled */
 
   /* Input queue.  Typed characters are stored here until read by a program. */
   u16_t *tty_inhead;		/* pointer to place where next char goes */
@@ -52,6 +56,7 @@ typedef struct tty {
   char tty_inhibited;		/* 1 when STOP (^S) just seen (stops output) */
   char tty_pgrp;		/* slot number of controlling process */
   char tty_openct;		/* count of number of opens of this tty */
+  char tty_passthru;		/* 1 when input needs no processing at all */
 
   /* Information about incomplete I/O requests is stored here. */
   char tty_inrepcode;		/* reply code, TASK_REPLY or REVIVE */
@@ -127,6 +132,7 @@ extern struct machine machine;	/* machine information (a.o.: pc_at, ega) */
 /* Function prototypes for TTY driver. */
 /* tty.c */
 _PROTOTYPE( void handle_events, (struct tty *tp)			);
+_PROTOTYPE( void set_events, (struct tty *tp)				);
 _PROTOTYPE( void sigchar, (struct tty *tp, int sig)			);
 _PROTOTYPE( void tty_task, (void)					);
 _PROTOTYPE( int in_process, (struct tty *tp, char *buf, int count)	);
@@ -142,6 +148,7 @@ _PROTOTYPE( int select_retry, (struct tty *tp)				);
 /* console.c */
 _PROTOTYPE( void kputc, (int c)						);
 _PROTOTYPE( void cons_stop, (void)					);
+_PROTOTYPE( void cons_render, (void)					);
 _PROTOTYPE( void do_new_kmess, (message *m)				);
 _PROTOTYPE( void do_diagnostics, (message *m)				);
 _PROTOTYPE( void scr_init, (struct tty *tp)				);
@@ -157,6 +164,12 @@ _PROTOTYPE( void do_panic_dumps, (message *m)				);
 _PROTOTYPE( void do_fkey_ctl, (message *m)				);
 _PROTOTYPE( void kbd_interrupt, (message *m)				);
 
+/* pty.c */
+_PROTOTYPE( void do_pty, (struct tty *tp, message *m_ptr)		);
+_PROTOTYPE( void pty_init, (struct tty *tp)				);
+_PROTOTYPE( void select_retry_pty, (struct tty *tp)			);
+_PROTOTYPE( int pty_status, (message *m_ptr)				);
+
 /* vidcopy.s */
 _PROTOTYPE( void vid_vid_copy, (unsigned src, unsigned dst, unsigned count));
 _PROTOTYPE( void mem_vid_copy, (u16_t *src, unsigned dst, unsigned count));
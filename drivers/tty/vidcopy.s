@@ -24,8 +24,8 @@
 !
 ! Copy count characters from kernel memory to video memory.  Src is an ordinary
 ! pointer to a word, but dst and count are character (word) based video offset
-! and count.  If src is null then screen memory is blanked by filling it with
-! blank_color.
+! and count.  Characters are moved two at a time, a line of text costs only
+! half as many bus cycles that way; an odd character is moved by itself.
 
 _mem_vid_copy:
 	push	ebp
@@ -49,17 +49,13 @@ mvc_loop:
 0:	sub	edx, ecx		! count -= ecx
 	shl	edi, 1			! byte address
 	add	edi, (_vid_off)		! in video memory
-	test	esi, esi		! source == 0 means blank the screen
-	jz	mvc_blank
 mvc_copy:
-	rep				! copy words to video memory
+	shr	ecx, 1			! count in word pairs, odd word in carry
+	rep				! copy word pairs to video memory
+	movs
+	adc	ecx, ecx		! ecx = 1 if a word is left over
+	rep				! copy the odd word
     o16	movs
-	jmp	mvc_test
-mvc_blank:
-	mov	eax, (_blank_color)	! ax = blanking character
-	rep
-    o16	stos				! copy blanks to video memory
-	!jmp	mvc_test
 mvc_test:
 	sub	edi, (_vid_off)
 	shr	edi, 1			! back to a word address
@@ -49,6 +49,11 @@ struct _v7_direct {
  */
 #define MAX_BLOCK_SIZE		 4096
 
+/* File systems with larger blocks can be mounted, but not booted from. The
+ * block size must fit in the 16 bit s_block_size field of the super block.
+ */
+#define MAX_LARGE_BLOCK_SIZE	32768
+
 /* This is the block size for the fixed versions of the filesystem (V1/V2) */
 #define STATIC_BLOCK_SIZE	1024
 
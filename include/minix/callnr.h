@@ -1,4 +1,4 @@
-#define NCALLS		  91	/* number of system calls allowed */
+#define NCALLS		  92	/* number of system calls allowed */
 
 #define EXIT		   1 
 #define FORK		   2 
@@ -79,3 +79,4 @@
 #define GETPRIORITY       88	/* to PM */
 #define SETPRIORITY       89	/* to PM */
 #define GETTIMEOFDAY      90	/* to PM */
+#define FSTATFS2          91	/* to FS */
@@ -317,6 +317,10 @@
 #   define GET_MACHINE 	  12	/* get machine information */
 #   define GET_LOCKTIMING 13	/* get lock()/unlock() latency timing */
 #   define GET_BIOSBUFFER 14	/* get a buffer for BIOS calls */
+#   define GET_KTRACE	  15	/* get kernel trace ring, set its mask */
+#   define GET_KPROF	  16	/* drain profiler samples, start or stop */
+#   define GET_CALLSTATS  17	/* get per kernel call statistics */
+#   define GET_IPCSTATS	  18	/* get IPC traffic matrix, start or stop */
 #define I_PROC_NR      m7_i4	/* calling process */
 #define I_VAL_PTR      m7_p1	/* virtual address at caller */ 
 #define I_VAL_LEN      m7_i1	/* max length of value */
@@ -408,5 +412,9 @@
 #  define DIAG_PRINT_BUF      m1_p1
 #  define DIAG_BUF_COUNT      m1_i1
 #  define DIAG_PROC_NR        m1_i2
+#define TRACE_EVENTS	101	/* hand a batch of trace records to LOG */
+#  define TRACE_BUF	      m1_p1	/* the records, see <minix/trace.h> */
+#  define TRACE_COUNT	      m1_i1	/* number of records */
+#  define TRACE_SOURCE	      m1_i2	/* TRS_* source of the records */
 
 #endif /* _MINIX_COM_H */ 
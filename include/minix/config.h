@@ -45,6 +45,17 @@
 
 #define NR_BUFS	128
 #define NR_BUF_HASH 128
+/* Buffers for blocks over MAX_BLOCK_SIZE bytes. Each one takes
+ * MAX_LARGE_BLOCK_SIZE bytes of FS memory, so there are none by default; set
+ * this to 6 or more to mount file systems with such blocks.
+ */
+#define NR_LBUFS   0
+
+/* Indexes of large directories. Each one takes 4 bytes of FS memory per entry;
+ * a directory with up to 3/4 as many slots as there are entries can have one.
+ */
+#define NR_DIRHASH	   1	/* directories indexed at a time */
+#define NR_DIRHASH_ENTRIES 4096	/* size of the largest index, a power of 2 */
 
 /* Number of controller tasks (/dev/cN device classes). */
 #define NR_CTRLRS          2
@@ -78,7 +89,7 @@
  */
 #define NR_CONS            4	/* # system consoles (1 to 8) */
 #define	NR_RS_LINES	   0	/* # rs232 terminals (0 to 4) */
-#define	NR_PTYS		   0	/* # pseudo terminals (0 to 64) */
+#define	NR_PTYS		  32	/* # pseudo terminals (0 to 64) */
 
 /*===========================================================================*
  *	There are no user-settable parameters after this line		     *
@@ -40,6 +40,8 @@ extern struct dmap {
 #  define NULL_DEV    		   3	/* minor device for /dev/null */
 #  define BOOT_DEV    		   4	/* minor device for /dev/boot */
 #  define ZERO_DEV    		   5	/* minor device for /dev/zero */
+#  define RAM1_DEV    		   6	/* minor devices for /dev/ram1, ... */
+#  define NR_RAM_DEVS 		   4	/* RAM disks, /dev/ram included */
 
 #define CTRLR(n) ((n)==0 ? 3 : (8 + 2*((n)-1)))	/* magic formula */
 
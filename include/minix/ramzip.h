@@ -0,0 +1,30 @@
+/* Definitions for compressed RAM disk images.
+ *
+ * A compressed image starts with a header of RZ_HDR_SIZE bytes. Bytes 1024
+ * to 2047 of the header are a copy of the same bytes of the image, so that
+ * the super block can be read where it always is. The header is followed by
+ * frames, each holding RZ_FRAME bytes of the image (the last one may hold
+ * fewer). A frame is a 32-bit length, then that many bytes in the LZ4 block
+ * format, or the bytes themselves if RZ_STORED is set in the length. All
+ * numbers are little endian. The whole is padded to a multiple of RZ_ALIGN.
+ *
+ * tools/ramzip makes such images; FS loads them onto the RAM disk.
+ */
+
+#ifndef _MINIX_RAMZIP_H
+#define _MINIX_RAMZIP_H
+
+#define RZ_MAGIC	"MINIXRZ1"	/* at the start of the header */
+#define RZ_MAGIC_LEN	8
+#define RZ_SIZE_OFF	8	/* header: bytes in the image */
+#define RZ_FRAME_OFF	12	/* header: image bytes per frame */
+#define RZ_HDR_SIZE	2048	/* the first frame starts here */
+#define RZ_ALIGN	512	/* the image is read in multiples of this */
+
+#define RZ_FRAME_MAX	65536L	/* largest number of bytes in a frame */
+#define RZ_STORED	0x80000000L	/* frame is not compressed */
+
+/* Largest LZ4 block for a frame, if it compresses badly. */
+#define RZ_CFRAME_MAX	(RZ_FRAME_MAX + RZ_FRAME_MAX / 255 + 16)
+
+#endif /* _MINIX_RAMZIP_H */
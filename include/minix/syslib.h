@@ -111,6 +111,10 @@ _PROTOTYPE(int sys_segctl, (int *index, u16_t *seg, vir_bytes *off,
 #define sys_getmonparams(v,vl)	sys_getinfo(GET_MONPARAMS, v,vl, 0,0)
 #define sys_getschedinfo(v1,v2)	sys_getinfo(GET_SCHEDINFO, v1,0, v2,0)
 #define sys_getlocktimings(dst)	sys_getinfo(GET_LOCKTIMING, dst, 0,0,0)
+#define sys_getktrace(dst,mask)	sys_getinfo(GET_KTRACE, dst, 0,0, mask)
+#define sys_getkprof(dst,on)	sys_getinfo(GET_KPROF, dst, 0,0, on)
+#define sys_getcallstats(dst)	sys_getinfo(GET_CALLSTATS, dst, 0,0,0)
+#define sys_getipcstats(dst,on)	sys_getinfo(GET_IPCSTATS, dst, 0,0, on)
 #define sys_getbiosbuffer(virp, sizep) sys_getinfo(GET_BIOSBUFFER, virp, \
 	sizeof(*virp), sizep, sizeof(*sizep))
 _PROTOTYPE(int sys_getinfo, (int request, void *val_ptr, int val_len,
@@ -0,0 +1,81 @@
+/* Definitions for binary event tracing.
+ *
+ * A trace record has a fixed size: a cycle counter timestamp, an event
+ * number, the process the event happened for, and three event specific
+ * arguments. The kernel writes its records into a ring that the LOG driver
+ * fetches with sys_getktrace(). Servers and drivers collect their records in
+ * a small batch and hand it to the LOG driver with a TRACE_EVENTS message.
+ * The LOG driver keeps a ring per source and hands out whole records on
+ * /dev/trace. Writing a long to /dev/trace sets the mask of event classes to
+ * record; a probe of a disabled class costs no more than a test.
+ */
+
+#ifndef _MINIX_TRACE_H
+#define _MINIX_TRACE_H
+
+struct trace_rec {
+  unsigned long tr_tsc_hi;	/* cycle counter when the event happened */
+  unsigned long tr_tsc_lo;	/* (zero if the CPU has no cycle counter) */
+  unsigned short tr_event;	/* event number, see TEV_* below */
+  short tr_proc;		/* process the event happened for */
+  long tr_arg[3];		/* event specific arguments */
+};
+
+/* Events are grouped in classes of 256. A class is enabled by setting its
+ * bit in the trace mask.
+ */
+#define TRACE_CLASS(ev)	(1 << ((ev) >> 8))
+#define TC_IPC		0x0000	/* kernel: message passing */
+#define TC_SCHED	0x0100	/* kernel: scheduling decisions */
+#define TC_IRQ		0x0200	/* kernel: hardware interrupts */
+#define TC_FS		0x0300	/* file system */
+#define TC_DISK		0x0400	/* disk drivers */
+#define TC_TRACE	0x0F00	/* the trace itself, always recorded */
+#define TC_KERNEL	(TRACE_CLASS(TC_IPC) | TRACE_CLASS(TC_SCHED) | \
+			 TRACE_CLASS(TC_IRQ))
+
+/* Event numbers and their arguments. */
+#define TEV_SEND	(TC_IPC + 0)	/* dst, blocked */
+#define TEV_RECEIVE	(TC_IPC + 1)	/* src, notification */
+#define TEV_BLOCK	(TC_IPC + 2)	/* src wanted */
+#define TEV_NOTIFY	(TC_IPC + 3)	/* dst, left pending */
+#define TEV_PICK	(TC_SCHED + 0)	/* queue */
+#define TEV_IRQ		(TC_IRQ + 0)	/* irq */
+#define TEV_BLK_HIT	(TC_FS + 0)	/* dev, block */
+#define TEV_BLK_MISS	(TC_FS + 1)	/* dev, block */
+#define TEV_DISK_CMD	(TC_DISK + 0)	/* command, ldh:cyl:sector, count */
+#define TEV_LOST	(TC_TRACE + 0)	/* source, records lost */
+
+/* Sources of records; the LOG driver keeps a ring for each. */
+#define TRS_KERNEL	   0	/* kernel ring, fetched by LOG */
+#define TRS_FS		   1	/* file system */
+#define TRS_DISK	   2	/* disk drivers */
+#define NR_TRACE_SOURCES   3
+
+/* The kernel ring. The 'next' field counts all records ever written, so a
+ * reader can tell which records are new and how many were overwritten.
+ */
+#define KTRACE_SIZE	 256	/* must be a power of two */
+struct ktrace {
+  unsigned kt_next;		/* sequence number of next record */
+  unsigned kt_mask;		/* event classes enabled in the kernel */
+  struct trace_rec kt_rec[KTRACE_SIZE];
+};
+
+/* Probes in servers and drivers. Like a kernel probe, a probe tests the mask
+ * of enabled classes, which LOG keeps up to date by notifying the process
+ * when it changes. TRACE_BATCH records go to LOG at once.
+ */
+#define TRACE_BATCH	  32	/* records per TRACE_EVENTS message */
+
+#define TRACE(ev, p, a, b, c) \
+	do { if (trace_mask & TRACE_CLASS(ev)) trace_put(ev, p, a, b, c); \
+	} while(0)
+
+extern long trace_mask;
+_PROTOTYPE( void trace_init, (int source)				);
+_PROTOTYPE( void trace_put, (int ev, int proc, long a, long b, long c)	);
+_PROTOTYPE( void trace_update, (void)					);
+_PROTOTYPE( void read_tsc, (unsigned long *high, unsigned long *low)	);
+
+#endif /* _MINIX_TRACE_H */
@@ -102,4 +102,59 @@ struct machine {
   int vdu_vga;
 };
 
+/* Samples of the statistical profiler, obtained through SYS_GETINFO. On
+ * every clock tick the kernel records which process was interrupted, and
+ * where. A process number of KERNEL means that kernel code was running.
+ */
+#define PROF_SAMPLES	 512	/* samples kept between two reads */
+struct prof_sample {
+  int ps_proc;			/* process that was running */
+  vir_bytes ps_pc;		/* its program counter */
+};
+
+struct kprof {
+  int kp_enabled;		/* profiler is running */
+  unsigned kp_count;		/* number of samples in the buffer */
+  unsigned long kp_lost;	/* samples dropped because it was full */
+  struct prof_sample kp_sample[PROF_SAMPLES];
+};
+
+/* Statistics the SYSTEM task keeps for every kernel call, obtained through
+ * SYS_GETINFO as an array of NR_SYS_CALLS entries. Counters only grow; to
+ * see what happened in an interval, subtract two snapshots. Cycle counts
+ * are zero if the CPU has no cycle counter.
+ */
+#define CALLSTAT_TOP	   4	/* busiest callers kept per call */
+struct callstat {
+  unsigned long cs_calls;	/* number of calls */
+  unsigned long cs_errors;	/* calls that failed */
+  unsigned long cs_cycles_hi;	/* total cycles spent handling them */
+  unsigned long cs_cycles_lo;
+  unsigned long cs_cycles_max;	/* cycles spent on the slowest call */
+  struct {
+	int cs_proc;		/* caller, or NONE if slot unused */
+	unsigned long cs_count;	/* (approximate) number of its calls */
+  } cs_top[CALLSTAT_TOP];
+};
+
+/* IPC traffic between processes, obtained through SYS_GETINFO. The result
+ * is a matrix of ipc_pair entries indexed by source and destination slot,
+ * followed by an ipc_wait entry per slot. A slot is a process number plus
+ * the number of tasks, and there are nr_tasks + nr_procs slots (see struct
+ * kinfo). Counting only happens while it is switched on, and switching it
+ * on clears all counters. Blocked time is counted in CPU cycles, so it is
+ * zero if the CPU has no cycle counter.
+ */
+struct ipc_pair {
+  unsigned long ip_send;	/* SEND and SENDREC, source to destination */
+  unsigned long ip_sendrec;	/* of which SENDREC */
+  unsigned long ip_receive;	/* messages the destination got, incl. notify */
+  unsigned long ip_notify;	/* NOTIFY, source to destination */
+};
+
+struct ipc_wait {
+  unsigned long iw_send[2];	/* cycles blocked SENDING, high and low */
+  unsigned long iw_recv[2];	/* cycles blocked RECEIVING, high and low */
+};
+
 #endif /* _TYPE_H */
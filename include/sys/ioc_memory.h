@@ -9,6 +9,13 @@
 
 #include <minix/ioctl.h>
 
+/* A range of a RAM disk whose contents are no longer needed. */
+struct ramdiscard {
+  u32_t rd_pos;			/* byte offset */
+  u32_t rd_size;		/* bytes, may be 0 to probe for support */
+};
+
 #define MIOCRAMSIZE	_IOW('m', 3, u32_t)
+#define MIOCDISCARD	_IOW('m', 4, struct ramdiscard)
 
 #endif /* _S_I_MEMORY_H */
@@ -0,0 +1,14 @@
+/* <sys/mount.h> - flags for the mount() system call. */
+
+#ifndef _MOUNT_H
+#define _MOUNT_H
+
+#define MS_RDONLY	0x0001	/* mount read only */
+#define MS_JOURNAL	0x0002	/* give a V3 file system a metadata journal */
+#define MS_NOATIME	0x0004	/* do not update access times */
+#define MS_RELATIME	0x0008	/* ... unless older than mtime, or a day old */
+#define MS_LAZYTIME	0x0010	/* keep access times in memory until evicted */
+#define MS_INLINE	0x0020	/* keep the data of small V3 files in the inode */
+#define MS_SNAPSHOT	0x0040	/* take a snapshot, see servers/fs/snap.c */
+
+#endif /* _MOUNT_H */
@@ -7,8 +7,16 @@
 #include <sys/types.h>
 #endif
 
+/* FSTATFS fills in f_bsize only, which is all that older programs have room
+ * for. FSTATFS2 also takes the size of the caller's struct, and fills in as
+ * much of it as fits.
+ */
 struct statfs {
   off_t f_bsize;		/* file system block size */
+  long f_blocks;		/* blocks on the file system */
+  long f_bfree;			/* blocks free */
+  long f_files;			/* inodes on the file system */
+  long f_ffree;			/* inodes free */
 };
 
 _PROTOTYPE( int fstatfs, (int fd, struct statfs *st)		);
@@ -179,8 +179,14 @@ PRIVATE int clock_handler(irq_hook_t *hook)
  *		These are used for accounting.  It does not matter if proc.c
  *		is changing them, provided they are always valid pointers,
  *		since at worst the previous process would be billed.
+ *	kprof:
+ *		Profiler samples. The SYSTEM task drains the buffer with
+ *		interrupts disabled.
  */
   register unsigned ticks;
+#if ENABLE_K_PROF
+  register struct prof_sample *ps;
+#endif
 
   /* Acknowledge the PS/2 clock interrupt. */
   if (machine.ps_mca) outb(PORT_B, inb(PORT_B) | CLOCK_ACK_BIT);
@@ -190,6 +196,26 @@ PRIVATE int clock_handler(irq_hook_t *hook)
   lost_ticks = 0;
   realtime += ticks;
 
+#if ENABLE_K_PROF
+  /* Take a profiler sample. If the kernel itself was interrupted, the saved
+   * registers of 'proc_ptr' are not where it was, so just count the kernel.
+   */
+  if (kprof.kp_enabled) {
+      if (kprof.kp_count < PROF_SAMPLES) {
+          ps = &kprof.kp_sample[kprof.kp_count++];
+          if (k_reenter > 0) {
+              ps->ps_proc = KERNEL;
+              ps->ps_pc = 0;
+          } else {
+              ps->ps_proc = proc_ptr->p_nr;
+              ps->ps_pc = proc_ptr->p_reg.pc;
+          }
+      } else {
+          kprof.kp_lost ++;
+      }
+  }
+#endif
+
   /* Update user and system accounting times. Charge the current process for
    * user time. If the current process is not billable, that is, if a non-user
    * process is running, charge the billable process for system time as well.
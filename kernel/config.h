@@ -51,7 +51,9 @@
 
 /* Kernel diagnostics are written to a circular buffer. After each message, 
  * a system server is notified and a copy of the buffer can be retrieved to 
- * display the message. The buffers size can safely be reduced.  
+ * display the message. The buffers size can safely be changed, but must be
+ * a power of two, because the write position is a free running sequence
+ * number that is masked to find the buffer index.
  */
 #define KMESS_BUF_SIZE   256   	
 
@@ -79,5 +81,25 @@
 #define DEBUG_LOCK_CHECK   0	/* kernel lock() sanity check */
 #define DEBUG_TIME_LOCKS   0	/* measure time spent in locks */
 
+/* Binary event tracing, see <minix/trace.h>. While tracing is off, a probe
+ * only tests the mask of enabled events. Set to 1 to put the probes in.
+ */
+#define ENABLE_K_TRACE     0	/* trace IPC, scheduling, and interrupts */
+
+/* Statistical profiling. When started with sys_getkprof(), the clock's
+ * interrupt handler records the running process and its program counter on
+ * every tick. When it is stopped, that costs a single test per tick.
+ */
+#define ENABLE_K_PROF      0	/* sample program counters */
+
+/* Count calls, failures, and cycles per kernel call in the SYSTEM task. */
+#define ENABLE_K_STATS     0	/* kernel call statistics */
+
+/* Count messages between every pair of processes, and the time processes
+ * spend blocked, while switched on with sys_getipcstats(). This costs a test
+ * per message while off, and NR_TASKS + NR_PROCS squared ipc_pair structs.
+ */
+#define ENABLE_K_IPCSTATS  0	/* IPC traffic matrix */
+
 #endif /* CONFIG_H */
 
@@ -62,6 +62,15 @@
 #define lock(c, v)	intr_disable(); 
 #define unlock(c)	intr_enable(); 
 
+/* Record a trace event if its class is enabled. See <minix/trace.h>. */
+#if ENABLE_K_TRACE
+#define KTRACE(ev, p, a, b, c) \
+	do { if (ktrace.kt_mask & TRACE_CLASS(ev)) \
+		ktrace_put(ev, p, a, b, c); } while(0)
+#else
+#define KTRACE(ev, p, a, b, c)
+#endif
+
 /* Sizes of memory tables. The boot monitor distinguishes three memory areas, 
  * namely low mem below 1M, 1M-16M, and mem after 16M. More chunks are needed
  * for DOS MINIX.
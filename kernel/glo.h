@@ -12,6 +12,7 @@
 #endif
 
 #include <minix/config.h>
+#include <minix/com.h>
 #include "config.h"
 
 /* Variables relating to shutting down MINIX. */
@@ -24,6 +25,22 @@ EXTERN struct kinfo kinfo;		/* kernel information for users */
 EXTERN struct machine machine;		/* machine information for users */
 EXTERN struct kmessages kmess;  	/* diagnostic messages in kernel */
 EXTERN struct randomness krandom;	/* gather kernel random information */
+#if ENABLE_K_TRACE
+EXTERN struct ktrace ktrace;		/* binary trace records */
+#endif
+#if ENABLE_K_PROF
+EXTERN struct kprof kprof;		/* profiler samples */
+#endif
+#if ENABLE_K_STATS
+EXTERN struct callstat callstats[NR_SYS_CALLS];	/* per kernel call */
+#endif
+#if ENABLE_K_IPCSTATS
+EXTERN int ipc_counting;		/* IPC traffic is being counted */
+EXTERN struct ipcstats {
+  struct ipc_pair is_pair[NR_TASKS+NR_PROCS][NR_TASKS+NR_PROCS];
+  struct ipc_wait is_wait[NR_TASKS+NR_PROCS];
+} ipcstats;				/* IPC traffic matrix */
+#endif
 
 /* Process scheduling information and the kernel reentry count. */
 EXTERN struct proc *prev_ptr;	/* previously running process */
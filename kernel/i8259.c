@@ -121,6 +121,8 @@ PUBLIC void intr_handle(irq_hook_t *hook)
  * controller(s) and enabled interrupts.
  */
 
+  if (hook != NULL) KTRACE(TEV_IRQ, HARDWARE, hook->irq, 0, 0);
+
   /* Call list of handlers for an IRQ. */
   while (hook != NULL) {
       /* For each handler in the list, mark it active by setting its ID bit,
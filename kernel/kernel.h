@@ -18,6 +18,7 @@
 #include <timers.h>		/* watchdog timer management */
 #include <errno.h>		/* return codes and error numbers */
 #include <ibm/portio.h>		/* device I/O and toggle interrupts */ 
+#include <minix/trace.h>	/* binary event trace records */
 
 /* Important kernel header files. */
 #include "config.h"		/* configuration, MUST be first */
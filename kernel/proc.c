@@ -51,6 +51,26 @@ FORWARD _PROTOTYPE( int mini_receive, (struct proc *caller_ptr, int src,
 		message *m_ptr, unsigned flags) );
 FORWARD _PROTOTYPE( int mini_notify, (struct proc *caller_ptr, int dst) );
 
+#if ENABLE_K_IPCSTATS
+FORWARD _PROTOTYPE( void ipc_block, (unsigned long stamp[2])		);
+FORWARD _PROTOTYPE( void ipc_unblock, (unsigned long stamp[2],
+				unsigned long total[2])			);
+
+#define IPC_SLOT(n)	((n) + NR_TASKS)
+#define IPC_COUNT(src, dst, ctr) \
+	do { if (ipc_counting) \
+		ipcstats.is_pair[IPC_SLOT(src)][IPC_SLOT(dst)].ctr++; } while(0)
+#define IPC_BLOCK(rp, which) \
+	do { if (ipc_counting) ipc_block((rp)->p_##which##_tsc); } while(0)
+#define IPC_UNBLOCK(rp, which) \
+	do { if (ipc_counting) ipc_unblock((rp)->p_##which##_tsc, \
+		ipcstats.is_wait[IPC_SLOT((rp)->p_nr)].iw_##which); } while(0)
+#else
+#define IPC_COUNT(src, dst, ctr)
+#define IPC_BLOCK(rp, which)
+#define IPC_UNBLOCK(rp, which)
+#endif
+
 FORWARD _PROTOTYPE( void enqueue, (struct proc *rp) );
 FORWARD _PROTOTYPE( void dequeue, (struct proc *rp) );
 FORWARD _PROTOTYPE( void sched, (struct proc *rp, int *queue, int *front) );
@@ -165,7 +185,9 @@ PUBLIC int sys_call(int call_nr, int src_dst, message *m_ptr)
         result = mini_send(caller_ptr, src_dst, m_ptr, flags);
         if (function == SEND || result != OK) {	
             break;				/* done, or SEND failed */
-        }						/* fall through for SENDREC */
+        }
+        IPC_COUNT(caller_ptr->p_nr, src_dst, ip_sendrec);
+        /* fall through for SENDREC */
     case RECEIVE:			
         if (function == RECEIVE)
             priv(caller_ptr)->s_flags &= ~SENDREC_BUSY;
@@ -219,8 +241,15 @@ PRIVATE int mini_send(register struct proc *caller_ptr, int dst, message *m_ptr,
 	CopyMess(caller_ptr->p_nr, caller_ptr, m_ptr, dst_ptr,
 		 dst_ptr->p_messbuf);
 	if ((dst_ptr->p_rts_flags &= ~RECEIVING) == 0) enqueue(dst_ptr);
+	KTRACE(TEV_SEND, caller_ptr->p_nr, dst, 0, 0);
+	IPC_COUNT(caller_ptr->p_nr, dst, ip_send);
+	IPC_COUNT(caller_ptr->p_nr, dst, ip_receive);
+	IPC_UNBLOCK(dst_ptr, recv);
   } else if ( ! (flags & NON_BLOCKING)) {
 	/* Destination is not waiting.  Block and dequeue caller. */
+	KTRACE(TEV_SEND, caller_ptr->p_nr, dst, 1, 0);
+	IPC_COUNT(caller_ptr->p_nr, dst, ip_send);
+	IPC_BLOCK(caller_ptr, send);
 	caller_ptr->p_messbuf = m_ptr;
 	if (caller_ptr->p_rts_flags == 0) dequeue(caller_ptr);
 	caller_ptr->p_rts_flags |= SENDING;
@@ -282,6 +311,8 @@ PRIVATE int mini_receive(register struct proc *caller_ptr, int src, message *m_p
             /* Found a suitable source, deliver the notification message. */
 	    BuildMess(&m, src_proc_nr, caller_ptr);	/* assemble message */
             CopyMess(src_proc_nr, proc_addr(HARDWARE), &m, caller_ptr, m_ptr);
+            KTRACE(TEV_RECEIVE, caller_ptr->p_nr, src_proc_nr, 1, 0);
+            IPC_COUNT(src_proc_nr, caller_ptr->p_nr, ip_receive);
             return(OK);					/* report success */
         }
     }
@@ -293,6 +324,9 @@ PRIVATE int mini_receive(register struct proc *caller_ptr, int src, message *m_p
 	    /* Found acceptable message. Copy it and update status. */
 	    CopyMess((*xpp)->p_nr, *xpp, (*xpp)->p_messbuf, caller_ptr, m_ptr);
             if (((*xpp)->p_rts_flags &= ~SENDING) == 0) enqueue(*xpp);
+            KTRACE(TEV_RECEIVE, caller_ptr->p_nr, (*xpp)->p_nr, 0, 0);
+            IPC_COUNT((*xpp)->p_nr, caller_ptr->p_nr, ip_receive);
+            IPC_UNBLOCK(*xpp, send);
             *xpp = (*xpp)->p_q_link;		/* remove from queue */
             return(OK);				/* report success */
 	}
@@ -304,6 +338,8 @@ PRIVATE int mini_receive(register struct proc *caller_ptr, int src, message *m_p
    * Block the process trying to receive, unless the flags tell otherwise.
    */
   if ( ! (flags & NON_BLOCKING)) {
+      KTRACE(TEV_BLOCK, caller_ptr->p_nr, src, 0, 0);
+      IPC_BLOCK(caller_ptr, recv);
       caller_ptr->p_getfrom = src;		
       caller_ptr->p_messbuf = m_ptr;
       if (caller_ptr->p_rts_flags == 0) dequeue(caller_ptr);
@@ -341,6 +377,10 @@ PRIVATE int mini_notify(register struct proc *caller_ptr, int dst)
           dst_ptr, dst_ptr->p_messbuf);
       dst_ptr->p_rts_flags &= ~RECEIVING;	/* deblock destination */
       if (dst_ptr->p_rts_flags == 0) enqueue(dst_ptr);
+      KTRACE(TEV_NOTIFY, proc_nr(caller_ptr), dst, 0, 0);
+      IPC_COUNT(proc_nr(caller_ptr), dst, ip_notify);
+      IPC_COUNT(proc_nr(caller_ptr), dst, ip_receive);
+      IPC_UNBLOCK(dst_ptr, recv);
       return(OK);
   } 
 
@@ -350,9 +390,42 @@ PRIVATE int mini_notify(register struct proc *caller_ptr, int dst)
    */ 
   src_id = priv(caller_ptr)->s_id;
   set_sys_bit(priv(dst_ptr)->s_notify_pending, src_id); 
+  KTRACE(TEV_NOTIFY, proc_nr(caller_ptr), dst, 1, 0);
+  IPC_COUNT(proc_nr(caller_ptr), dst, ip_notify);
   return(OK);
 }
 
+#if ENABLE_K_IPCSTATS
+/*===========================================================================*
+ *				ipc_block				     * 
+ *===========================================================================*/
+/* where to note the time */
+PRIVATE void ipc_block(unsigned long stamp[2])
+{
+/* A process blocks; remember when. A zero stamp means 'unknown'. */
+  stamp[0] = stamp[1] = 0;
+  if (machine.processor > 486) read_tsc(&stamp[0], &stamp[1]);
+}
+
+/*===========================================================================*
+ *				ipc_unblock				     * 
+ *===========================================================================*/
+/* when the process blocked */
+/* total blocked time to add to */
+PRIVATE void ipc_unblock(unsigned long stamp[2], unsigned long total[2])
+{
+/* A process is no longer blocked; add the time it was to its total. */
+  unsigned long now[2], lo;
+
+  if ((stamp[0] | stamp[1]) == 0) return;	/* not known when it blocked */
+  read_tsc(&now[0], &now[1]);
+  lo = now[1] - stamp[1];
+  total[0] += now[0] - stamp[0] - (now[1] < stamp[1] ? 1 : 0);
+  if ((total[1] += lo) < lo) total[0] ++;
+  stamp[0] = stamp[1] = 0;
+}
+#endif /* ENABLE_K_IPCSTATS */
+
 /*===========================================================================*
  *				lock_notify				     *
  *===========================================================================*/
@@ -526,6 +599,7 @@ PRIVATE void pick_proc()
           next_ptr = rp;			/* run process 'rp' next */
           if (priv(rp)->s_flags & BILLABLE)	 	
               bill_ptr = rp;			/* bill for system time */
+          KTRACE(TEV_PICK, rp->p_nr, q, 0, 0);
           return;				 
       }
   }
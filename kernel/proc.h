@@ -43,6 +43,11 @@ struct proc {
   sigset_t p_pending;		/* bit map for pending kernel signals */
 
   char p_name[P_NAME_LEN];	/* name of the process, including \0 */
+
+#if ENABLE_K_IPCSTATS
+  unsigned long p_send_tsc[2];	/* cycle counter when it blocked sending */
+  unsigned long p_recv_tsc[2];	/* cycle counter when it blocked receiving */
+#endif
 };
 
 /* Bits for the runtime flags. A process is runnable iff p_rts_flags == 0. */
@@ -22,6 +22,7 @@ _PROTOTYPE( void prepare_shutdown, (int how)				);
 /* utility.c */
 _PROTOTYPE( void kprintf, (const char *fmt, ...)			);
 _PROTOTYPE( void panic, (_CONST char *s, int n)				);
+_PROTOTYPE( void ktrace_put, (int ev, int proc, long a, long b, long c)	);
 
 /* proc.c */
 _PROTOTYPE( int sys_call, (int function, int src_dest, message *m_ptr)	);
@@ -50,6 +50,10 @@ PUBLIC int (*call_vec[NR_SYS_CALLS])(message *m_ptr);
     call_vec[(call_nr-KERNEL_CALL)] = (handler)  
 
 FORWARD _PROTOTYPE( void initialize, (void));
+#if ENABLE_K_STATS
+FORWARD _PROTOTYPE( void call_stats, (int call_nr, int caller, int result,
+				unsigned long start_hi, unsigned long start_lo));
+#endif
 
 /*===========================================================================*
  *				sys_task				     *
@@ -62,6 +66,9 @@ PUBLIC void sys_task()
   register struct proc *caller_ptr;
   unsigned int call_nr;
   int s;
+#if ENABLE_K_STATS
+  unsigned long start_hi, start_lo;	/* cycle counter at start of call */
+#endif
 
   /* Initialize the system task. */
   initialize();
@@ -71,6 +78,10 @@ PUBLIC void sys_task()
       receive(ANY, &m);			
       call_nr = (unsigned) m.m_type - KERNEL_CALL;	
       caller_ptr = proc_addr(m.m_source);	
+#if ENABLE_K_STATS
+      start_hi = start_lo = 0;
+      if (machine.processor > 486) read_tsc(&start_hi, &start_lo);
+#endif
 
       /* See if the caller made a valid request and try to handle it. */
       if (! (priv(caller_ptr)->s_call_mask & (1<<call_nr))) {
@@ -83,6 +94,10 @@ PUBLIC void sys_task()
       else {
           result = (*call_vec[call_nr])(&m);	/* handle the kernel call */
       }
+#if ENABLE_K_STATS
+      if (call_nr < NR_SYS_CALLS)
+          call_stats(call_nr, m.m_source, result, start_hi, start_lo);
+#endif
 
       /* Send a reply, unless inhibited by a handler function. Use the kernel
        * function lock_send() to prevent a system call trap. The destination
@@ -105,6 +120,13 @@ PRIVATE void initialize(void)
   register struct priv *sp;
   int i;
 
+#if ENABLE_K_STATS
+  /* No callers are known yet for the kernel call statistics. */
+  for (i=0; i<NR_SYS_CALLS * CALLSTAT_TOP; i++) {
+      callstats[i / CALLSTAT_TOP].cs_top[i % CALLSTAT_TOP].cs_proc = NONE;
+  }
+#endif
+
   /* Initialize IRQ handler hooks. Mark all hooks available. */
   for (i=0; i<NR_IRQ_HOOKS; i++) {
       irq_hooks[i].proc_nr = NONE;
@@ -194,6 +216,48 @@ PUBLIC int get_priv(register struct proc *rc, int proc_type)
   return(OK);
 }
 
+#if ENABLE_K_STATS
+/*===========================================================================*
+ *				call_stats				     *
+ *===========================================================================*/
+/* kernel call that was handled */
+/* process that made the call */
+/* result of the handler */
+/* cycle counter when the call arrived */
+PRIVATE void call_stats(int call_nr, int caller, int result,
+	unsigned long start_hi, unsigned long start_lo)
+{
+/* Account a kernel call. The busiest callers are tracked approximately in a
+ * few slots per call: a caller that has no slot takes over the one with the
+ * lowest count, and continues from that count. Frequent callers thus keep
+ * their slot, and a count is never less than the caller's real number.
+ */
+  register struct callstat *cs = &callstats[call_nr];
+  unsigned long end_hi, end_lo, cycles;
+  int i, min;
+
+  cs->cs_calls ++;
+  if (result < 0 && result != EDONTREPLY) cs->cs_errors ++;
+
+  if (machine.processor > 486) {
+      read_tsc(&end_hi, &end_lo);
+      cycles = end_lo - start_lo;		/* calls take less than 2^32 */
+      if ((cs->cs_cycles_lo += cycles) < cycles) cs->cs_cycles_hi ++;
+      if (cycles > cs->cs_cycles_max) cs->cs_cycles_max = cycles;
+  }
+
+  for (i = min = 0; i < CALLSTAT_TOP; i++) {
+      if (cs->cs_top[i].cs_proc == caller) {
+          cs->cs_top[i].cs_count ++;
+          return;
+      }
+      if (cs->cs_top[i].cs_count < cs->cs_top[min].cs_count) min = i;
+  }
+  cs->cs_top[min].cs_proc = caller;
+  cs->cs_top[min].cs_count ++;
+}
+#endif /* ENABLE_K_STATS */
+
 /*===========================================================================*
  *				get_randomness				     *
  *===========================================================================*/
@@ -6,7 +6,7 @@
  *    m1_p1:	I_VAL_PTR 	(where to put it)	
  *    m1_i1:	I_VAL_LEN 	(maximum length expected, optional)	
  *    m1_p2:	I_VAL_PTR2	(second, optional pointer)	
- *    m1_i2:	I_VAL_LEN2	(second length or process nr)	
+ *    m1_i2:	I_VAL_LEN2	(second length, process nr, or trace mask)	
  */
 
 #include "../system.h"
@@ -105,6 +105,69 @@ PUBLIC int do_getinfo(register message *m_ptr)
         src_phys = vir2phys(&kmess);
         break;
     }
+#if ENABLE_K_TRACE
+    case GET_KTRACE: {
+        /* Install the caller's mask of kernel event classes, unless it is
+         * negative, and copy the ring as it is now. 
+         */
+        if (m_ptr->I_VAL_LEN2 >= 0) ktrace.kt_mask = m_ptr->I_VAL_LEN2;
+        length = sizeof(struct ktrace);
+        src_phys = vir2phys(&ktrace);
+        break;
+    }
+#endif
+#if ENABLE_K_PROF
+    case GET_KPROF: {
+        /* Hand out the samples taken so far and empty the buffer. This must
+         * not race with the clock's interrupt handler, hence the lock. The
+         * profiler is started or stopped if I_VAL_LEN2 is not negative.
+         */
+        static struct kprof copy;		/* copy of the samples */
+
+        lock(9, "getkprof");
+        copy = kprof;
+        kprof.kp_count = 0;
+        kprof.kp_lost = 0;
+        if (m_ptr->I_VAL_LEN2 >= 0) kprof.kp_enabled = m_ptr->I_VAL_LEN2;
+        unlock(9);
+        length = sizeof(struct kprof);
+        src_phys = vir2phys(&copy);
+        break;
+    }
+#endif
+#if ENABLE_K_STATS
+    case GET_CALLSTATS: {
+        length = sizeof(struct callstat) * NR_SYS_CALLS;
+        src_phys = vir2phys(callstats);
+        break;
+    }
+#endif
+#if ENABLE_K_IPCSTATS
+    case GET_IPCSTATS: {
+        /* Starting clears the counters, and forgets when processes blocked,
+         * since they did so before counting started. I_VAL_LEN2 is positive
+         * to start, zero to stop, and negative to just get the counters.
+         */
+        struct proc *rp;
+
+        if (m_ptr->I_VAL_LEN2 > 0) {
+            lock(10, "ipcstats");
+            phys_memset(vir2phys(&ipcstats), 0, sizeof(ipcstats));
+            for (rp = BEG_PROC_ADDR; rp < END_PROC_ADDR; rp++) {
+                rp->p_send_tsc[0] = rp->p_send_tsc[1] = 0;
+                rp->p_recv_tsc[0] = rp->p_recv_tsc[1] = 0;
+            }
+            ipc_counting = TRUE;
+            unlock(10);
+        } 
+        else if (m_ptr->I_VAL_LEN2 == 0) {
+            ipc_counting = FALSE;
+        }
+        length = sizeof(ipcstats);
+        src_phys = vir2phys(&ipcstats);
+        break;
+    }
+#endif
 #if DEBUG_TIME_LOCKS
     case GET_LOCKTIMING: {
     length = sizeof(timingdata);
@@ -28,9 +28,12 @@ struct memory {
   phys_clicks size;			/* size of memory chunk */
 };
 
-/* The kernel outputs diagnostic messages in a circular buffer. */
+/* The kernel outputs diagnostic messages in a circular buffer. The 'next'
+ * field counts all bytes ever written; a reader that remembers the previous
+ * value can tell how many bytes are new and how many were overwritten.
+ */
 struct kmessages {
-  int km_next;				/* next index to write */
+  unsigned km_next;			/* sequence number of next byte */
   int km_size;				/* current size in buffer */
   char km_buf[KMESS_BUF_SIZE];		/* buffer for messages */
 };
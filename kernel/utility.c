@@ -1,6 +1,7 @@
 /* This file contains a collection of miscellaneous procedures:
  *   panic:	    abort MINIX due to a fatal error
  *   kprintf:	    diagnostic output for the kernel 
+ *   ktrace_put:    record a binary trace event
  *
  * Changes:
  *   Dec 10, 2004   kernel printing to circular buffer  (Jorrit N. Herder)
@@ -128,12 +129,44 @@ PRIVATE void kputc(int c)
  * to the output driver if an END_OF_KMESS is encountered. 
  */
   if (c != END_OF_KMESS) {
-      kmess.km_buf[kmess.km_next] = c;	/* put normal char in buffer */
+      kmess.km_buf[kmess.km_next & (KMESS_BUF_SIZE-1)] = c;
       if (kmess.km_size < KMESS_BUF_SIZE)
           kmess.km_size += 1;		
-      kmess.km_next = (kmess.km_next + 1) % KMESS_BUF_SIZE;
+      kmess.km_next ++;				/* free running sequence */
   } else {
       send_sig(OUTPUT_PROC_NR, SIGKMESS);
   }
 }
 
+
+#if ENABLE_K_TRACE
+/*===========================================================================*
+ *				ktrace_put			     	     *
+ *===========================================================================*/
+/* event number */
+/* process the event happened for */
+/* event specific arguments */
+PUBLIC void ktrace_put(int ev, int proc, long a, long b, long c)
+{
+/* Append a record to the kernel trace ring. This is only called through the
+ * KTRACE() macro, after the event's class was found to be enabled. The ring
+ * is only touched with interrupts disabled, so no locking is needed. Old
+ * records are overwritten; the LOG driver can tell from the sequence number.
+ */
+  register struct trace_rec *tr;
+
+  tr = &ktrace.kt_rec[ktrace.kt_next & (KTRACE_SIZE-1)];
+  if (machine.processor > 486) {
+      read_tsc(&tr->tr_tsc_hi, &tr->tr_tsc_lo);
+  } else {
+      tr->tr_tsc_hi = 0;
+      tr->tr_tsc_lo = 0;
+  }
+  tr->tr_event = ev;
+  tr->tr_proc = proc;
+  tr->tr_arg[0] = a;
+  tr->tr_arg[1] = b;
+  tr->tr_arg[2] = c;
+  ktrace.kt_next ++;
+}
+#endif /* ENABLE_K_TRACE */
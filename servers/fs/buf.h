@@ -9,28 +9,39 @@
  * front of the list, if it will probably not be needed soon.  If a block
  * is modified, the modifying routine must set b_dirt to DIRTY, so the block
  * will eventually be rewritten to the disk.
+ *
+ * There are two sizes of buffers, each with its own LRU chain. Devices whose
+ * blocks are at most MAX_BLOCK_SIZE bytes use the NR_BUFS small buffers;
+ * devices with larger blocks use the NR_LBUFS large buffers, which hold up
+ * to MAX_LARGE_BLOCK_SIZE bytes.
  */
 
 #include <sys/dir.h>			/* need struct direct */
 #include <dirent.h>
 
-EXTERN struct buf {
-  /* Data portion of the buffer. */
-  union {
-    char b__data[MAX_BLOCK_SIZE];		     /* ordinary user data */
+/* Data portion of a buffer. Only the first b_bytes bytes exist. */
+union blkdata {
+    char b__data[MAX_LARGE_BLOCK_SIZE];		     /* ordinary user data */
 /* directory block */
-    struct direct b__dir[NR_DIR_ENTRIES(MAX_BLOCK_SIZE)];    
+    struct direct b__dir[NR_DIR_ENTRIES(MAX_LARGE_BLOCK_SIZE)];
 /* V1 indirect block */
     zone1_t b__v1_ind[V1_INDIRECTS];	     
 /* V2 indirect block */
-    zone_t  b__v2_ind[V2_INDIRECTS(MAX_BLOCK_SIZE)];	     
+    zone_t  b__v2_ind[V2_INDIRECTS(MAX_LARGE_BLOCK_SIZE)];
 /* V1 inode block */
     d1_inode b__v1_ino[V1_INODES_PER_BLOCK]; 
 /* V2 inode block */
-    d2_inode b__v2_ino[V2_INODES_PER_BLOCK(MAX_BLOCK_SIZE)]; 
+    d2_inode b__v2_ino[V2_INODES_PER_BLOCK(MAX_LARGE_BLOCK_SIZE)];
 /* bit map block */
-    bitchunk_t b__bitmap[FS_BITMAP_CHUNKS(MAX_BLOCK_SIZE)];  
-  } b;
+    bitchunk_t b__bitmap[FS_BITMAP_CHUNKS(MAX_LARGE_BLOCK_SIZE)];
+};
+
+#define NR_ALL_BUFS	(NR_BUFS + NR_LBUFS)
+
+EXTERN struct buf {
+  /* Data portion of the buffer. */
+  union blkdata *b_blk;		/* points into buf_space */
+  unsigned b_bytes;		/* MAX_BLOCK_SIZE or MAX_LARGE_BLOCK_SIZE */
 
   /* Header portion of the buffer. */
   struct buf *b_next;		/* used to link all free bufs in a chain */
@@ -40,25 +51,43 @@ EXTERN struct buf {
   dev_t b_dev;			/* major | minor device where block resides */
   char b_dirt;			/* CLEAN or DIRTY */
   char b_count;			/* number of users of this buffer */
-} buf[NR_BUFS];
+  ino_t b_ino;			/* file whose data or indirect block it is */
+  char b_journal;		/* in the open journal transaction */
+} buf[NR_ALL_BUFS];
+
+/* The data of all buffers, small ones first. */
+EXTERN long buf_space[(NR_BUFS * (long) MAX_BLOCK_SIZE +
+			NR_LBUFS * (long) MAX_LARGE_BLOCK_SIZE) / sizeof(long)];
 
-/* A block is free if b_dev == NO_DEV. */
+/* A block is free if b_dev == NO_DEV. Whoever dirties a data, directory, or
+ * indirect block of a file sets b_ino to the file's inode number, so fsync()
+ * can find the blocks of one file. Other blocks have b_ino == NO_ENTRY.
+ */
 
 #define NIL_BUF ((struct buf *) 0)	/* indicates absence of a buffer */
 
-/* These defs make it possible to use to bp->b_data instead of bp->b.b__data */
-#define b_data   b.b__data
-#define b_dir    b.b__dir
-#define b_v1_ind b.b__v1_ind
-#define b_v2_ind b.b__v2_ind
-#define b_v1_ino b.b__v1_ino
-#define b_v2_ino b.b__v2_ino
-#define b_bitmap b.b__bitmap
+/* These defs make it possible to use bp->b_data instead of bp->b_blk->b__data */
+#define b_data   b_blk->b__data
+#define b_dir    b_blk->b__dir
+#define b_v1_ind b_blk->b__v1_ind
+#define b_v2_ind b_blk->b__v2_ind
+#define b_v1_ino b_blk->b__v1_ino
+#define b_v2_ino b_blk->b__v2_ino
+#define b_bitmap b_blk->b__bitmap
 
 EXTERN struct buf *buf_hash[NR_BUF_HASH];	/* the buffer hash table */
 
-EXTERN struct buf *front;	/* points to least recently used free block */
-EXTERN struct buf *rear;	/* points to most recently used free block */
+EXTERN struct bufclass {
+  struct buf *bc_front;		/* points to least recently used free block */
+  struct buf *bc_rear;		/* points to most recently used free block */
+  int bc_in_use;		/* # bufs currently in use (not on free list)*/
+  int bc_count;			/* # bufs of this size */
+} bufclass[2];
+
+#define SMALL_BUFS	0	/* for blocks up to MAX_BLOCK_SIZE */
+#define LARGE_BUFS	1	/* for blocks up to MAX_LARGE_BLOCK_SIZE */
+#define BUF_CLASS(bp)	(&bufclass[(bp) >= &buf[NR_BUFS]])	/* 0 or 1 */
+
 EXTERN int bufs_in_use;		/* # bufs currently in use (not on free list)*/
 
 /* When a block is released, the type of usage is passed to put_block(). */
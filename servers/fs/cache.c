@@ -6,19 +6,31 @@
  * The entry points into this file are:
  *   get_block:	  request to fetch a block for reading or writing from cache
  *   put_block:	  return a block previously requested with get_block
+ *   in_cache:	  tell if a block is in the cache, without fetching it
  *   alloc_zone:  allocate a new zone (to increase the length of a file)
  *   free_zone:	  release a zone (when a file is removed)
+ *   discard_flush: tell a RAM disk which zones were freed
+ *   discard_probe: tell if a device wants to know about freed zones
+ *   direct_dev:  tell if file data may go straight to a device
  *   rw_block:	  read or write a block from the disk itself
  *   invalidate:  remove all the cache blocks on some device
  */
 
 #include "fs.h"
 #include <minix/com.h>
+#include <minix/trace.h>
+#include <sys/ioc_memory.h>
 #include "buf.h"
 #include "file.h"
 #include "fproc.h"
+#include "inode.h"
 #include "super.h"
 
+/* Zones freed on a device that takes MIOCDISCARD, not discarded yet. */
+PRIVATE dev_t dc_dev;		/* the device */
+PRIVATE zone_t dc_first;	/* first zone */
+PRIVATE zone_t dc_count;	/* number of consecutive zones */
+
 FORWARD _PROTOTYPE( void rm_lru, (struct buf *bp) );
 
 /*===========================================================================*
@@ -39,20 +51,24 @@ PUBLIC struct buf *get_block(register dev_t dev, register block_t block, int onl
  * will do.  It is not necessary to actually read the block in from disk.
  * If 'only_search' is PREFETCH, the block need not be read from the disk,
  * and the device is not to be marked on the block, so callers can tell if
- * the block returned is valid.
+ * the block returned is valid. The buffer is large enough for the blocks of
+ * 'dev'; NO_DEV gets a small buffer. If 'only_search' is UNNAMED, the cache
+ * is not searched at all, and a free buffer for the blocks of 'dev' comes
+ * back unnamed, as with NO_DEV.
  * In addition to the LRU chain, there is also a hash chain to link together
  * blocks whose block numbers end with the same bit strings, for fast lookup.
  */
 
   int b;
   register struct buf *bp, *prev_ptr;
+  struct bufclass *bc;
 
   /* Search the hash chain for (dev, block). Do_read() can use 
-   * get_block(NO_DEV ...) to get an unnamed block to fill with zeros when
-   * someone wants to read from a hole in a file, in which case this search
-   * is skipped
+   * get_block(dev, NO_BLOCK, UNNAMED) to get an unnamed block to fill with
+   * zeros when someone wants to read from a hole in a file, in which case this
+   * search is skipped
    */
-  if (dev != NO_DEV) {
+  if (dev != NO_DEV && only_search != UNNAMED) {
 	b = (int) block & HASH_MASK;
 	bp = buf_hash[b];
 	while (bp != NIL_BUF) {
@@ -61,6 +77,7 @@ PUBLIC struct buf *get_block(register dev_t dev, register block_t block, int onl
 			if (bp->b_count == 0) rm_lru(bp);
 			bp->b_count++;	/* record that block is in use */
 
+			TRACE(TEV_BLK_HIT, who, dev, block, 0);
 			return(bp);
 		} else {
 			/* This block is not the one sought. */
@@ -69,8 +86,15 @@ PUBLIC struct buf *get_block(register dev_t dev, register block_t block, int onl
 	}
   }
 
-  /* Desired block is not on available chain.  Take oldest block ('front'). */
-  if ((bp = front) == NIL_BUF) panic(__FILE__,"all buffers in use", NR_BUFS);
+  /* Desired block is not on available chain.  Take oldest block ('front')
+   * of the size the device needs.
+   */
+  TRACE(TEV_BLK_MISS, who, dev, block, only_search);
+  bc = &bufclass[SMALL_BUFS];
+  if (dev != NO_DEV && get_block_size(dev) > MAX_BLOCK_SIZE)
+	bc = &bufclass[LARGE_BUFS];
+  if ((bp = bc->bc_front) == NIL_BUF)
+	panic(__FILE__,"all buffers in use", bc->bc_count);
   rm_lru(bp);
 
   /* Remove the block that was just taken from its hash chain. */
@@ -99,6 +123,7 @@ PUBLIC struct buf *get_block(register dev_t dev, register block_t block, int onl
   /* Fill in block's parameters and add it to the hash chain where it goes. */
   bp->b_dev = dev;		/* fill in device number */
   bp->b_blocknr = block;	/* fill in block number */
+  bp->b_ino = NO_ENTRY;		/* not known to belong to a file */
   bp->b_count++;		/* record that block is being used */
   b = (int) bp->b_blocknr & HASH_MASK;
   bp->b_hash = buf_hash[b];
@@ -106,7 +131,8 @@ PUBLIC struct buf *get_block(register dev_t dev, register block_t block, int onl
 
   /* Go get the requested block unless searching or prefetching. */
   if (dev != NO_DEV) {
-	if (only_search == PREFETCH) bp->b_dev = NO_DEV;
+	if (only_search == PREFETCH || only_search == UNNAMED)
+		bp->b_dev = NO_DEV;
 	else
 	if (only_search == NORMAL) {
 		rw_block(bp, READING);
@@ -130,12 +156,16 @@ PUBLIC void put_block(register struct buf *bp, int block_type)
  * the integrity of the file system (e.g., inode blocks) are written to
  * disk immediately if they are dirty.
  */
+  struct bufclass *bc;
+
   if (bp == NIL_BUF) return;	/* it is easier to check here than in caller */
 
   bp->b_count--;		/* there is one use fewer now */
   if (bp->b_count != 0) return;	/* block is still in use */
 
+  bc = BUF_CLASS(bp);
   bufs_in_use--;		/* one fewer block buffers in use */
+  bc->bc_in_use--;
 
   /* Put this block back on the LRU chain.  If the ONE_SHOT bit is set in
    * 'block_type', the block is not likely to be needed again shortly, so put
@@ -147,25 +177,30 @@ PUBLIC void put_block(register struct buf *bp, int block_type)
   	 * It will be the next block to be evicted from the cache.
   	 */
 	bp->b_prev = NIL_BUF;
-	bp->b_next = front;
-	if (front == NIL_BUF)
-		rear = bp;	/* LRU chain was empty */
+	bp->b_next = bc->bc_front;
+	if (bc->bc_front == NIL_BUF)
+		bc->bc_rear = bp;	/* LRU chain was empty */
 	else
-		front->b_prev = bp;
-	front = bp;
+		bc->bc_front->b_prev = bp;
+	bc->bc_front = bp;
   } else {
 	/* Block probably will be needed quickly.  Put it on rear of chain.
   	 * It will not be evicted from the cache for a long time.
   	 */
-	bp->b_prev = rear;
+	bp->b_prev = bc->bc_rear;
 	bp->b_next = NIL_BUF;
-	if (rear == NIL_BUF)
-		front = bp;
+	if (bc->bc_rear == NIL_BUF)
+		bc->bc_front = bp;
 	else
-		rear->b_next = bp;
-	rear = bp;
+		bc->bc_rear->b_next = bp;
+	bc->bc_rear = bp;
   }
 
+  /* On a file system with a journal, dirty metadata joins the open journal
+   * transaction, and may only go home after that has been committed.
+   */
+  if (bp->b_dirt == DIRTY && bp->b_dev != NO_DEV) journal_add(bp, block_type);
+
   /* Some blocks are so important (e.g., inodes, indirect blocks) that they
    * should be written to the disk immediately to avoid messing up the file
    * system in the event of a crash.
@@ -175,6 +210,21 @@ PUBLIC void put_block(register struct buf *bp, int block_type)
   } 
 }
 
+/*===========================================================================*
+ *				in_cache				     *
+ *===========================================================================*/
+/* on which device is the block? */
+/* which block? */
+PUBLIC int in_cache(Dev_t dev, block_t block)
+{
+/* Tell whether a block is in the cache. It is neither fetched nor moved. */
+  register struct buf *bp;
+
+  for (bp = buf_hash[(int) block & HASH_MASK]; bp != NIL_BUF; bp = bp->b_hash)
+	if (bp->b_blocknr == block && bp->b_dev == dev) return(TRUE);
+  return(FALSE);
+}
+
 /*===========================================================================*
  *				alloc_zone				     *
  *===========================================================================*/
@@ -197,6 +247,9 @@ PUBLIC zone_t alloc_zone(dev_t dev, zone_t z)
    */
   sp = get_super(dev);
 
+  /* A zone waiting to be discarded may be about to be used again. */
+  if (dc_count > 0 && dc_dev == dev) discard_flush();
+
   /* If z is 0, skip initial part of the map known to be fully in use. */
   if (z == sp->s_firstdatazone) {
 	bit = sp->s_zsearch;
@@ -234,6 +287,69 @@ PUBLIC void free_zone(dev_t dev, zone_t numb)
   bit = (bit_t) (numb - (sp->s_firstdatazone - 1));
   free_bit(sp, ZMAP, bit);
   if (bit < sp->s_zsearch) sp->s_zsearch = bit;
+  journal_revoke(sp, numb);	/* old copies in the journal are void */
+
+  /* A RAM disk can give the memory back. Runs of zones are told at once. */
+  if (sp->s_discard) {
+	if (dc_count > 0 && (dc_dev != dev || numb != dc_first + dc_count))
+		discard_flush();
+	if (dc_count == 0) {
+		dc_dev = dev;
+		dc_first = numb;
+	}
+	dc_count++;
+  }
+}
+
+/*===========================================================================*
+ *				discard_flush				     *
+ *===========================================================================*/
+PUBLIC void discard_flush()
+{
+/* Tell the driver about the zones freed since the last time. This is done at
+ * the end of every call, and before a zone is allocated on the device.
+ */
+  struct super_block *sp;
+  struct ramdiscard range;
+
+  if (dc_count == 0) return;
+  sp = get_super(dc_dev);
+  range.rd_pos = ((u32_t) dc_first << sp->s_log_zone_size) * sp->s_block_size;
+  range.rd_size = ((u32_t) dc_count << sp->s_log_zone_size) * sp->s_block_size;
+  dc_count = 0;
+
+  /* The zones may still be part of a snapshot. */
+  snap_copy(dc_dev, (off_t) range.rd_pos, (unsigned) range.rd_size);
+  (void) dev_io(DEV_IOCTL, dc_dev, FS_PROC_NR, (void *) &range, 0L,
+							MIOCDISCARD, 0);
+}
+
+/*===========================================================================*
+ *				discard_probe				     *
+ *===========================================================================*/
+/* device of a file system being mounted */
+PUBLIC int discard_probe(Dev_t dev)
+{
+/* Ask the driver to discard nothing, to see if it knows how. */
+  struct ramdiscard range;
+
+  range.rd_pos = 0;
+  range.rd_size = 0;
+  return(dev_io(DEV_IOCTL, dev, FS_PROC_NR, (void *) &range, 0L,
+						MIOCDISCARD, 0) == OK);
+}
+
+/*===========================================================================*
+ *				direct_dev				     *
+ *===========================================================================*/
+/* device of a file system being mounted */
+PUBLIC int direct_dev(Dev_t dev)
+{
+/* Tell whether the device is memory, which can be read and written at any
+ * byte, so that file data can be copied between it and the user at once.
+ * The store of a snapshot cannot: its blocks may come from another device.
+ */
+  return(((dev >> MAJOR) & BYTE) == MEMORY_MAJOR && !snap_view(dev));
 }
 
 /*===========================================================================*
@@ -257,8 +373,16 @@ PUBLIC void rw_block(register struct buf *bp, int rw_flag)
   block_size = get_block_size(bp->b_dev);
 
   if ( (dev = bp->b_dev) != NO_DEV) {
+	if (rw_flag == WRITING && bp->b_journal) journal_commit(dev);
 	pos = (off_t) bp->b_blocknr * block_size;
-	op = (rw_flag == READING ? DEV_READ : DEV_WRITE);
+	if (rw_flag == READING) {
+		op = DEV_READ;
+		dev = snap_dev(dev, pos);	/* snapshot: may be elsewhere */
+	} else {
+		op = DEV_WRITE;
+		journal_write(dev, bp->b_blocknr, 1);
+		snap_copy(dev, pos, block_size); /* save for a snapshot */
+	}
 	r = dev_io(op, dev, FS_PROC_NR, bp->b_data, pos, block_size, 0);
 	if (r != block_size) {
 	    if (r >= 0) r = END_OF_FILE;
@@ -285,7 +409,7 @@ PUBLIC void invalidate(dev_t device)
 
   register struct buf *bp;
 
-  for (bp = &buf[0]; bp < &buf[NR_BUFS]; bp++)
+  for (bp = &buf[0]; bp < &buf[NR_ALL_BUFS]; bp++)
 	if (bp->b_dev == device) bp->b_dev = NO_DEV;
 }
 
@@ -298,14 +422,44 @@ PUBLIC void flushall(dev_t dev)
 /* Flush all dirty blocks for one device. */
 
   register struct buf *bp;
-  static struct buf *dirty[NR_BUFS];	/* static so it isn't on stack */
+  static struct buf *dirty[NR_ALL_BUFS];	/* static so it isn't on stack */
   int ndirty;
 
-  for (bp = &buf[0], ndirty = 0; bp < &buf[NR_BUFS]; bp++)
+  for (bp = &buf[0], ndirty = 0; bp < &buf[NR_ALL_BUFS]; bp++)
 	if (bp->b_dirt == DIRTY && bp->b_dev == dev) dirty[ndirty++] = bp;
   rw_scattered(dev, dirty, ndirty, WRITING);
 }
 
+/*===========================================================================*
+ *				flushfile				     *
+ *===========================================================================*/
+/* the file to flush */
+PUBLIC void flushfile(struct inode *rip)
+{
+/* Flush the dirty blocks of one file: those tagged with its inode number,
+ * the block its inode is in, and the dirty inode and zone map blocks of the
+ * device, which may hold the bits of its inode and zones. Other dirty blocks
+ * of the device stay cached.
+ */
+
+  register struct buf *bp;
+  static struct buf *dirty[NR_ALL_BUFS];	/* static so it isn't on stack */
+  int ndirty;
+  dev_t dev;
+  block_t iblock, map_end;
+
+  dev = rip->i_dev;
+  iblock = inode_blocknr(rip);
+  map_end = START_BLOCK + rip->i_sp->s_imap_blocks + rip->i_sp->s_zmap_blocks;
+
+  for (bp = &buf[0], ndirty = 0; bp < &buf[NR_ALL_BUFS]; bp++)
+	if (bp->b_dirt == DIRTY && bp->b_dev == dev &&
+	    (bp->b_ino == rip->i_num || bp->b_blocknr == iblock ||
+	    (bp->b_blocknr >= START_BLOCK && bp->b_blocknr < map_end)))
+		dirty[ndirty++] = bp;
+  rw_scattered(dev, dirty, ndirty, WRITING);
+}
+
 /*===========================================================================*
  *				rw_scattered				     *
  *===========================================================================*/
@@ -324,9 +478,17 @@ PUBLIC void rw_scattered(dev_t dev, struct buf **bufq, int bufqsize, int rw_flag
   static iovec_t iovec[NR_IOREQS];  /* static so it isn't on stack */
   int j, r;
   int block_size;
+  off_t pos;
+  dev_t iodev;
 
   block_size = get_block_size(dev);
 
+  /* Blocks in the open journal transaction go home after it is committed. */
+  if (rw_flag == WRITING) {
+	for (i = 0; i < bufqsize && !bufq[i]->b_journal; i++) {}
+	if (i < bufqsize) journal_commit(dev);
+  }
+
   /* (Shell) sort buffers on b_blocknr. */
   gap = 1;
   do
@@ -349,15 +511,24 @@ PUBLIC void rw_scattered(dev_t dev, struct buf **bufq, int bufqsize, int rw_flag
    * went fine, otherwise the error code for the first failed transfer.
    */  
   while (bufqsize > 0) {
+	/* A run of blocks of a snapshot store is read from one device. */
+	pos = (off_t) bufq[0]->b_blocknr * block_size;
+	iodev = (rw_flag == READING ? snap_dev(dev, pos) : dev);
 	for (j = 0, iop = iovec; j < NR_IOREQS && j < bufqsize; j++, iop++) {
 		bp = bufq[j];
 		if (bp->b_blocknr != bufq[0]->b_blocknr + j) break;
+		if (rw_flag == READING &&
+		    snap_dev(dev, (off_t) bp->b_blocknr * block_size) != iodev)
+			break;
 		iop->iov_addr = (vir_bytes) bp->b_data;
 		iop->iov_size = block_size;
 	}
+	if (rw_flag == WRITING) {
+		journal_write(dev, bufq[0]->b_blocknr, j);
+		snap_copy(dev, pos, j * block_size);
+	}
 	r = dev_io(rw_flag == WRITING ? DEV_SCATTER : DEV_GATHER,
-		dev, FS_PROC_NR, iovec,
-		(off_t) bufq[0]->b_blocknr * block_size, j, 0);
+		iodev, FS_PROC_NR, iovec, pos, j, 0);
 
 	/* Harvest the results.  Dev_io reports the first error it may have
 	 * encountered, but we only care if it's the first block that failed.
@@ -411,17 +582,20 @@ PRIVATE void rm_lru(struct buf *bp)
 {
 /* Remove a block from its LRU chain. */
   struct buf *next_ptr, *prev_ptr;
+  struct bufclass *bc;
 
+  bc = BUF_CLASS(bp);
   bufs_in_use++;
+  bc->bc_in_use++;
   next_ptr = bp->b_next;	/* successor on LRU chain */
   prev_ptr = bp->b_prev;	/* predecessor on LRU chain */
   if (prev_ptr != NIL_BUF)
 	prev_ptr->b_next = next_ptr;
   else
-	front = next_ptr;	/* this block was at front of chain */
+	bc->bc_front = next_ptr;	/* this block was at front of chain */
 
   if (next_ptr != NIL_BUF)
 	next_ptr->b_prev = prev_ptr;
   else
-	rear = prev_ptr;	/* this block was at rear of chain */
+	bc->bc_rear = prev_ptr;	/* this block was at rear of chain */
 }
@@ -33,6 +33,7 @@
 #define NORMAL	           0	/* forces get_block to do disk read */
 #define NO_READ            1	/* prevents get_block from doing disk read */
 #define PREFETCH           2	/* tells get_block not to read or mark dev */
+#define UNNAMED            3	/* an unnamed buffer sized for dev's blocks */
 
 #define XPIPE   (-NR_TASKS-1)	/* used in fp_task when susp'd on pipe */
 #define XLOCK   (-NR_TASKS-2)	/* used in fp_task when susp'd on lock */
@@ -68,6 +69,12 @@
 #define SUPER_SIZE      usizeof (struct super_block)  /* super_block size    */
 #define PIPE_SIZE(b)          (V1_NR_DZONES*(b))  /* pipe size in bytes  */
 
+/* Largest block of a file system that can be mounted; without large buffers,
+ * file systems with blocks over MAX_BLOCK_SIZE cannot.
+ */
+#define MAX_MOUNT_BLOCK_SIZE \
+		(NR_LBUFS > 0 ? MAX_LARGE_BLOCK_SIZE : MAX_BLOCK_SIZE)
+
 #define FS_BITMAP_CHUNKS(b) ((b)/usizeof (bitchunk_t))/* # map chunks/blk   */
 #define FS_BITCHUNK_BITS		(usizeof(bitchunk_t) * CHAR_BIT)
 #define FS_BITS_PER_BLOCK(b)	(FS_BITMAP_CHUNKS(b) * FS_BITCHUNK_BITS)
@@ -87,3 +94,30 @@
 #define V2_INODE_SIZE             usizeof (d2_inode)  /* bytes in V2 dsk ino */
 #define V2_INDIRECTS(b)   ((b)/V2_ZONE_NUM_SIZE)  /* # zones/indir block */
 #define V2_INODES_PER_BLOCK(b) ((b)/V2_INODE_SIZE)/* # V2 dsk inodes/blk */
+
+/* A small V3 file may keep its data in the zone numbers of its inode. This is
+ * marked in the high byte of d2_gid, which is unused since gid_t is a char.
+ */
+#define INLINE_MAX (V2_NR_TZONES * V2_ZONE_NUM_SIZE)	/* bytes inline */
+#define DI_FLAGS	0xFF00	/* high byte of d2_gid */
+#define DI_INLINE	0x0100	/* the data is inline */
+
+#define INODE_DELAY	   2	/* seconds before released inodes go back */
+#define RELATIME_AGE  86400L	/* MS_RELATIME: atime updated once a day */
+
+/* Indexes of large directories, see dirhash.c. */
+#define DH_MAX_USED (NR_DIRHASH_ENTRIES/4*3) /* slots in largest dir indexed */
+#define DH_MIN_BLOCKS	   4	/* smaller directories are just scanned */
+
+/* Copy-on-write snapshots, see snap.c. */
+#define SNAP_MAX_BLOCKS 262144L	/* largest file system, in blocks */
+
+/* The metadata journal, see journal.c. */
+#define JOURNAL_BLOCKS	1024	/* size of a new journal in blocks */
+#define JOURNAL_DELAY	   5	/* seconds before a transaction commits */
+#define JTRANS_MAX (NR_IOREQS - 2)	/* blocks in one transaction */
+#define JREVOKE_MAX	  64	/* blocks revoked by one transaction */
+#define JREVOKE_TOTAL	 512	/* blocks revoked in the journal at a time */
+#define JH_MAGIC  0x4a484452L	/* journal header */
+#define JD_MAGIC  0x4a444553L	/* transaction descriptor */
+#define JC_MAGIC  0x4a434d54L	/* transaction commit */
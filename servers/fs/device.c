@@ -58,7 +58,13 @@ PUBLIC int dev_open(dev_t dev, int proc, int flags)
 /* device to close */
 PUBLIC void dev_close(dev_t dev)
 {
-  (void) (*dmap[(dev >> MAJOR) & BYTE].dmap_opcl)(DEV_CLOSE, dev, 0, 0);
+/* Close a device for the process FS works for, so that a driver that keeps
+ * something per process can let go of it. While FS starts, that is FS.
+ */
+  int proc;
+
+  proc = (fp != (struct fproc *) NULL ? (int) (fp - fproc) : FS_PROC_NR);
+  (void) (*dmap[(dev >> MAJOR) & BYTE].dmap_opcl)(DEV_CLOSE, dev, proc, 0);
 }
 
 /*===========================================================================*
@@ -0,0 +1,327 @@
+/* This file keeps an index in memory for large directories, so that looking up
+ * or deleting a name, or finding a free slot to enter one, does not take a
+ * scan of the whole directory. The index of a directory is built with one
+ * scan the first time it is searched, and search_dir() keeps it up to date as
+ * names are entered and deleted.
+ *
+ * An index is a hash table of directory slot numbers, with open addressing.
+ * Each table entry also holds the high bits of the hash of its name, so that
+ * nearly all mismatches are found without reading the directory block. The
+ * table is sized to the directory when the index is built: the smallest power
+ * of 2 that is less than 3/4 full with all slots in use. When it fills up as
+ * the directory grows, the index is built again, twice as large. Only
+ * NR_DIRHASH directories can have an index at a time; the one used least
+ * recently gives way. Nothing is kept on the disk, so the file system format
+ * does not change. An index is rebuilt if the directory size changes behind
+ * its back, and dropped when the directory is freed or its device unmounted.
+ *
+ * The entry points into this file are
+ *   dirhash_get:	find or build the index of a directory
+ *   dirhash_find:	look up a name through the index
+ *   dirhash_hint:	tell where ENTER should start looking for a free slot
+ *   dirhash_enter:	add a name just entered to the index
+ *   dirhash_delete:	remove a name just deleted from the index
+ *   dirhash_drop:	forget the index of a directory, or of a whole device
+ */
+
+#include "fs.h"
+#include <string.h>
+#include "buf.h"
+#include "inode.h"
+#include "super.h"
+
+#define DH_SLOT(e)	((e) & 0x00FFFFFFL)	/* slot number + 1 */
+#define DH_TAG(h)	((h) & 0xFF000000L)	/* high bits of the hash */
+#define DH_EMPTY	0L			/* entry never used */
+#define DH_DELETED	0x00FFFFFFL		/* entry used, then deleted */
+#define DH_NEXT(dh, i)	(((i) + 1) & (dh)->dh_mask)
+#define DH_FULL(dh)	(((dh)->dh_mask + 1) / 4 * 3)	/* rebuild at */
+
+PRIVATE struct dirhash {
+  dev_t dh_dev;			/* device of the directory, NO_DEV if free */
+  ino_t dh_ino;			/* inode number of the directory */
+  off_t dh_size;		/* directory size the index is valid for */
+  unsigned dh_mask;		/* table entries in use - 1 */
+  unsigned dh_used;		/* table entries that are not DH_EMPTY */
+  unsigned dh_free;		/* free slots in the directory */
+  unsigned dh_hint;		/* no slot below this one is free */
+  unsigned long dh_stamp;	/* last use, for replacement */
+  u32_t dh_tab[NR_DIRHASH_ENTRIES];	/* hash table, dh_mask+1 used */
+} dirhash[NR_DIRHASH];
+
+#define NIL_DIRHASH (struct dirhash *) 0
+
+PRIVATE unsigned long dh_clock;	/* counts uses of indexes */
+
+FORWARD _PROTOTYPE( struct dirhash *dh_lookup, (struct inode *dirp)	);
+FORWARD _PROTOTYPE( void dh_build, (struct dirhash *dh, struct inode *dirp) );
+FORWARD _PROTOTYPE( void dh_insert, (struct dirhash *dh, char *string,
+							unsigned slot)	);
+FORWARD _PROTOTYPE( u32_t dh_hash, (char *string)			);
+
+/*===========================================================================*
+ *				dirhash_get				     *
+ *===========================================================================*/
+/* directory about to be searched */
+PUBLIC int dirhash_get(struct inode *dirp)
+{
+/* Return TRUE if the directory has an index. Build one if the directory is
+ * large enough to be worth it, and small enough to fit.
+ */
+  register struct dirhash *dh, *xp;
+  unsigned slots;
+
+  if (dirp->i_size < DH_MIN_BLOCKS * (off_t) dirp->i_sp->s_block_size)
+	return(FALSE);
+  slots = (unsigned) (dirp->i_size / DIR_ENTRY_SIZE);
+  if (slots >= DH_MAX_USED) return(FALSE);
+
+  /* Look for the index, remembering the least recently used one. */
+  xp = &dirhash[0];
+  for (dh = &dirhash[0]; dh < &dirhash[NR_DIRHASH]; dh++) {
+	if (dh->dh_dev == dirp->i_dev && dh->dh_ino == dirp->i_num) {
+		xp = dh;
+		break;
+	}
+	if (dh->dh_stamp < xp->dh_stamp) xp = dh;
+  }
+  xp->dh_stamp = ++dh_clock;
+
+  /* An index for another directory, or an index that is out of date because
+   * the directory changed size other than through ENTER, is replaced.
+   */
+  if (xp->dh_dev != dirp->i_dev || xp->dh_ino != dirp->i_num ||
+  					xp->dh_size != dirp->i_size) {
+	dh_build(xp, dirp);
+  }
+  return(TRUE);
+}
+
+/*===========================================================================*
+ *				dirhash_find				     *
+ *===========================================================================*/
+/* indexed directory to search */
+/* name to look for */
+/* the block holding the name is returned here */
+/* its slot number is returned here */
+PUBLIC int dirhash_find(struct inode *dirp, char string[NAME_MAX],
+			struct buf **bpp, unsigned *slotp)
+{
+/* Look up 'string' in an indexed directory. If it is there, return OK with
+ * the directory block in '*bpp'; the caller must put it. Else return ENOENT.
+ */
+  register struct dirhash *dh;
+  register struct buf *bp;
+  struct direct *dp;
+  u32_t h, e;
+  unsigned i, slot, epb;
+
+  dh = dh_lookup(dirp);
+  epb = NR_DIR_ENTRIES(dirp->i_sp->s_block_size);
+  h = dh_hash(string);
+  for (i = h & dh->dh_mask; (e = dh->dh_tab[i]) != DH_EMPTY;
+  						i = DH_NEXT(dh, i)) {
+	if (e == DH_DELETED || DH_TAG(e) != DH_TAG(h)) continue;
+
+	/* The hash matches; see if the name does. */
+	slot = (unsigned) DH_SLOT(e) - 1;
+	bp = get_block(dirp->i_dev,
+		read_map(dirp, (off_t) slot * DIR_ENTRY_SIZE), NORMAL);
+	dp = &bp->b_dir[slot % epb];
+	if (dp->d_ino != 0 && strncmp(dp->d_name, string, NAME_MAX) == 0) {
+		*bpp = bp;
+		*slotp = slot;
+		return(OK);
+	}
+	put_block(bp, DIRECTORY_BLOCK);
+  }
+  return(ENOENT);
+}
+
+/*===========================================================================*
+ *				dirhash_hint				     *
+ *===========================================================================*/
+/* indexed directory to enter a name in */
+PUBLIC unsigned dirhash_hint(struct inode *dirp)
+{
+/* Return the first slot that may be free. If none is, that is the slot just
+ * past the end, and ENTER goes straight to extending the directory.
+ */
+  register struct dirhash *dh;
+
+  dh = dh_lookup(dirp);
+  if (dh->dh_free == 0) return((unsigned) (dh->dh_size / DIR_ENTRY_SIZE));
+  return(dh->dh_hint);
+}
+
+/*===========================================================================*
+ *				dirhash_enter				     *
+ *===========================================================================*/
+/* indexed directory a name was entered in */
+/* the name */
+/* the slot it went into */
+PUBLIC void dirhash_enter(struct inode *dirp, char string[NAME_MAX],
+			unsigned slot)
+{
+/* Add a name that search_dir() has just entered to the index. */
+  register struct dirhash *dh;
+
+  if ((dh = dh_lookup(dirp)) == NIL_DIRHASH) return;
+
+  if (slot < (unsigned) (dh->dh_size / DIR_ENTRY_SIZE)) {
+	dh->dh_free--;		/* a free slot was used */
+	dh->dh_hint = slot + 1;
+  }
+  dh->dh_size = dirp->i_size;
+
+  /* Too many deleted entries, or a directory grown too large for the table,
+   * and the index goes; the next search builds a new one that fits, if the
+   * directory is not too large for any.
+   */
+  if (dh->dh_used >= DH_FULL(dh)) {
+	dh->dh_dev = NO_DEV;
+	return;
+  }
+  dh_insert(dh, string, slot);
+}
+
+/*===========================================================================*
+ *				dirhash_delete				     *
+ *===========================================================================*/
+/* indexed directory a name was deleted from */
+/* the name */
+/* the slot it was in */
+PUBLIC void dirhash_delete(struct inode *dirp, char string[NAME_MAX],
+			unsigned slot)
+{
+/* Remove a name that search_dir() has just deleted from the index. */
+  register struct dirhash *dh;
+  unsigned i;
+
+  if ((dh = dh_lookup(dirp)) == NIL_DIRHASH) return;
+
+  for (i = dh_hash(string) & dh->dh_mask; dh->dh_tab[i] != DH_EMPTY;
+  							i = DH_NEXT(dh, i)) {
+	if (dh->dh_tab[i] != DH_DELETED && DH_SLOT(dh->dh_tab[i]) == slot + 1) {
+		dh->dh_tab[i] = DH_DELETED;
+		break;
+	}
+  }
+  dh->dh_free++;
+  if (slot < dh->dh_hint) dh->dh_hint = slot;
+}
+
+/*===========================================================================*
+ *				dirhash_drop				     *
+ *===========================================================================*/
+/* device of the directory */
+/* the directory, or 0 for all on 'dev' */
+PUBLIC void dirhash_drop(Dev_t dev, Ino_t ino)
+{
+/* A directory was freed or its device unmounted; forget its index. */
+  register struct dirhash *dh;
+
+  for (dh = &dirhash[0]; dh < &dirhash[NR_DIRHASH]; dh++) {
+	if (dh->dh_dev == dev && (ino == 0 || dh->dh_ino == ino))
+		dh->dh_dev = NO_DEV;
+  }
+}
+
+/*===========================================================================*
+ *				dh_lookup				     *
+ *===========================================================================*/
+/* directory whose index is wanted */
+PRIVATE struct dirhash *dh_lookup(struct inode *dirp)
+{
+  register struct dirhash *dh;
+
+  for (dh = &dirhash[0]; dh < &dirhash[NR_DIRHASH]; dh++) {
+	if (dh->dh_dev == dirp->i_dev && dh->dh_ino == dirp->i_num)
+		return(dh);
+  }
+  return(NIL_DIRHASH);
+}
+
+/*===========================================================================*
+ *				dh_build				     *
+ *===========================================================================*/
+/* index to fill */
+/* directory to index */
+PRIVATE void dh_build(struct dirhash *dh, struct inode *dirp)
+{
+/* Scan the whole directory and enter every name in use in the index. Only
+ * the part of the table that the directory needs is used, and cleared.
+ */
+  register struct direct *dp;
+  struct buf *bp;
+  unsigned slot, slots, epb, n;
+
+  dh->dh_dev = dirp->i_dev;
+  dh->dh_ino = dirp->i_num;
+  dh->dh_size = dirp->i_size;
+  dh->dh_used = 0;
+  dh->dh_free = 0;
+  slots = (unsigned) (dirp->i_size / DIR_ENTRY_SIZE);
+  dh->dh_hint = slots;
+  for (n = 4; n / 4 * 3 <= slots; n <<= 1) {}	/* dirhash_get() bounds n */
+  dh->dh_mask = n - 1;
+  (void) memset((char *) dh->dh_tab, 0, n * sizeof(dh->dh_tab[0]));
+
+  /* Since directories don't have holes, every block can be read. */
+  epb = NR_DIR_ENTRIES(dirp->i_sp->s_block_size);
+  bp = NIL_BUF;
+  for (slot = 0; slot < slots; slot++) {
+	if (slot % epb == 0) {
+		put_block(bp, DIRECTORY_BLOCK);
+		bp = get_block(dirp->i_dev,
+			read_map(dirp, (off_t) slot * DIR_ENTRY_SIZE), NORMAL);
+	}
+	dp = &bp->b_dir[slot % epb];
+	if (dp->d_ino != 0) {
+		dh_insert(dh, dp->d_name, slot);
+	} else if (dh->dh_free++ == 0) {
+		dh->dh_hint = slot;	/* first free slot */
+	}
+  }
+  put_block(bp, DIRECTORY_BLOCK);
+}
+
+/*===========================================================================*
+ *				dh_insert				     *
+ *===========================================================================*/
+/* index to add to */
+/* the name */
+/* its slot in the directory */
+PRIVATE void dh_insert(struct dirhash *dh, char *string, unsigned slot)
+{
+/* Put a name in the first empty or deleted entry of its chain. The table is
+ * never more than 3/4 full, so there always is one.
+ */
+  u32_t h;
+  unsigned i;
+
+  h = dh_hash(string);
+  for (i = h & dh->dh_mask; dh->dh_tab[i] != DH_EMPTY &&
+  			dh->dh_tab[i] != DH_DELETED; i = DH_NEXT(dh, i))
+	;
+  if (dh->dh_tab[i] == DH_EMPTY) dh->dh_used++;
+  dh->dh_tab[i] = DH_TAG(h) | (slot + 1);
+}
+
+/*===========================================================================*
+ *				dh_hash					     *
+ *===========================================================================*/
+/* name of at most NAME_MAX characters */
+PRIVATE u32_t dh_hash(char *string)
+{
+/* Hash a name (FNV-1a). */
+  register u32_t h;
+  register int i;
+
+  h = 2166136261L;
+  for (i = 0; i < NAME_MAX && string[i] != '\0'; i++) {
+	h ^= (unsigned char) string[i];
+	h *= 16777619L;
+  }
+  return(h);
+}
@@ -6,27 +6,40 @@
  *   get_inode:	   search inode table for a given inode; if not there,
  *                 read it
  *   put_inode:	   indicate that an inode is no longer needed in memory
+ *   flush_inodes: write back dirty inodes, a whole inode block at a time
  *   alloc_inode:  allocate a new, unused inode
  *   wipe_inode:   erase some fields of a newly allocated inode
  *   free_inode:   mark an inode as available for a new file
  *   update_times: update atime, ctime, and mtime
+ *   mark_atime:   mark atime for update after a read, as the mount says
  *   rw_inode:	   read a disk block and extract an inode, or corresp. write
+ *   inode_blocknr: tell which block an inode is in
+ *   prefetch_inodes: read the inode blocks a directory block refers to
  *   old_icopy:	   copy to/from in-core inode struct and disk inode (V1.x)
  *   new_icopy:	   copy to/from in-core inode struct and disk inode (V2.x)
  *   dup_inode:	   indicate that someone else is using an inode table entry
  */
 
 #include "fs.h"
+#include <string.h>
+#include <timers.h>
 #include "buf.h"
 #include "file.h"
 #include "fproc.h"
 #include "inode.h"
 #include "super.h"
+#include <sys/mount.h>
 
+PRIVATE timer_t itimer;		/* writes back released dirty inodes */
+PRIVATE int itimer_set;		/* TRUE if the timer is running */
+
+FORWARD _PROTOTYPE( void icopy, (struct inode *rip, struct buf *bp,
+						int rw_flag)		);
 FORWARD _PROTOTYPE( void old_icopy, (struct inode *rip, d1_inode *dip,
 						int direction, int norm));
 FORWARD _PROTOTYPE( void new_icopy, (struct inode *rip, d2_inode *dip,
 						int direction, int norm));
+FORWARD _PROTOTYPE( void inode_timeout, (timer_t *tp)			);
 
 /*===========================================================================*
  *				get_inode				     *
@@ -37,6 +50,10 @@ PUBLIC struct inode *get_inode(dev_t dev, int numb)
 {
 /* Find a slot in the inode table, load the specified inode into it, and
  * return a pointer to the slot.  If 'dev' == NO_DEV, just return a free slot.
+ * A slot that is no longer used but still dirty is not free yet; it holds
+ * the latest copy of its inode until flush_inodes() has written it back.
+ * A slot holding only an access time kept in memory (MS_LAZYTIME) may be
+ * reused once the inode has been written.
  */
 
   register struct inode *rip, *xp;
@@ -44,7 +61,8 @@ PUBLIC struct inode *get_inode(dev_t dev, int numb)
   /* Search the inode table both for (dev, numb) and a free slot. */
   xp = NIL_INODE;
   for (rip = &inode[0]; rip < &inode[NR_INODES]; rip++) {
-	if (rip->i_count > 0) { /* only check used slots for (dev, numb) */
+	if (rip->i_count > 0 || rip->i_dirt == DIRTY || rip->i_lazy) {
+		/* Only check slots with something in them for (dev, numb). */
 		if (rip->i_dev == dev && rip->i_num == numb) {
 			/* This is the inode that we are looking for. */
 			rip->i_count++;
@@ -55,6 +73,13 @@ PUBLIC struct inode *get_inode(dev_t dev, int numb)
 	}
   }
 
+  /* If only dirty slots are left, write them back to free them. */
+  if (xp == NIL_INODE) {
+	flush_inodes(FALSE);
+	for (rip = &inode[0]; rip < &inode[NR_INODES]; rip++)
+		if (rip->i_count == 0) xp = rip;
+  }
+
   /* Inode we want is not currently in use.  Did we find a free slot? */
   if (xp == NIL_INODE) {	/* inode table completely full */
 	err_code = ENFILE;
@@ -62,6 +87,8 @@ PUBLIC struct inode *get_inode(dev_t dev, int numb)
   }
 
   /* A free inode slot has been located.  Load the inode into it. */
+  if (xp->i_dev != NO_DEV && xp->i_lazy) rw_inode(xp, WRITING);
+  xp->i_lazy = FALSE;
   xp->i_dev = dev;
   xp->i_num = numb;
   xp->i_count = 1;
@@ -78,8 +105,9 @@ PUBLIC struct inode *get_inode(dev_t dev, int numb)
 PUBLIC void put_inode(register struct inode *rip)
 {
 /* The caller is no longer using this inode.  If no one else is using it either
- * write it back to the disk immediately.  If it has no links, truncate it and
- * return it to the pool of available inodes.
+ * and it is dirty, it will be written back shortly, together with other dirty
+ * inodes in the same block.  If it has no links, truncate it and return it to
+ * the pool of available inodes.
  */
 
   if (rip == NIL_INODE) return;	/* checking here is easier than in caller */
@@ -94,7 +122,39 @@ PUBLIC void put_inode(register struct inode *rip)
 		if (rip->i_pipe == I_PIPE) truncate(rip);
 	}
 	rip->i_pipe = NO_PIPE;  /* should always be cleared */
-	if (rip->i_dirt == DIRTY) rw_inode(rip, WRITING);
+	if (rip->i_dirt == DIRTY && !itimer_set) {
+		fs_init_timer(&itimer);
+		fs_set_timer(&itimer, INODE_DELAY * HZ, inode_timeout, 0);
+		itimer_set = TRUE;
+	}
+  }
+}
+
+/*===========================================================================*
+ *				flush_inodes				     *
+ *===========================================================================*/
+/* also write access times kept in memory? */
+PUBLIC void flush_inodes(int lazy)
+{
+/* Write all dirty inodes to their blocks in the cache. Each inode block is
+ * fetched once, and all dirty inodes in it are copied at the same time.
+ */
+  register struct inode *rip, *xp;
+  register struct buf *bp;
+  block_t b;
+
+#define MUST_WRITE(ip) \
+	((ip)->i_dirt == DIRTY || (lazy && (ip)->i_lazy))
+  for (rip = &inode[0]; rip < &inode[NR_INODES]; rip++) {
+	if (!MUST_WRITE(rip) || rip->i_dev == NO_DEV) continue;
+	rip->i_sp = get_super(rip->i_dev);
+	b = inode_blocknr(rip);
+	bp = get_block(rip->i_dev, b, NORMAL);
+	for (xp = rip; xp < &inode[NR_INODES]; xp++) {
+		if (MUST_WRITE(xp) && xp->i_dev == rip->i_dev
+				&& inode_blocknr(xp) == b) icopy(xp, bp, WRITING);
+	}
+	put_block(bp, INODE_BLOCK);
   }
 }
 
@@ -105,7 +165,7 @@ PUBLIC struct inode *alloc_inode(dev_t dev, mode_t bits)
 {
 /* Allocate a free inode on 'dev', and return a pointer to it. */
 
-  register struct inode *rip;
+  register struct inode *rip, *xp;
   register struct super_block *sp;
   int major, minor, inumb;
   bit_t b;
@@ -134,6 +194,14 @@ PUBLIC struct inode *alloc_inode(dev_t dev, mode_t bits)
 	/* No inode table slots available.  Free the inode just allocated. */
 	free_bit(sp, IMAP, b);
   } else {
+	/* The inode may have been freed so recently that its old copy still
+	 * waits to be written back. This one replaces it.
+	 */
+	for (xp = &inode[0]; xp < &inode[NR_INODES]; xp++) {
+		if (xp->i_count == 0 && xp->i_dev == dev && xp->i_num == inumb)
+			xp->i_dirt = CLEAN, xp->i_lazy = FALSE, xp->i_update = 0;
+	}
+
 	/* An inode slot is available. Put the inode just allocated into it. */
 	rip->i_mode = bits;		/* set up RWX bits */
 	rip->i_nlinks = 0;		/* initial no links */
@@ -171,6 +239,7 @@ PUBLIC void wipe_inode(register struct inode *rip)
   rip->i_size = 0;
   rip->i_update = ATIME | CTIME | MTIME;	/* update all times later */
   rip->i_dirt = DIRTY;
+  rip->i_inline = FALSE;
   for (i = 0; i < V2_NR_TZONES; i++) rip->i_zone[i] = NO_ZONE;
 }
 
@@ -192,6 +261,7 @@ PUBLIC void free_inode(dev_t dev, ino_t inumb)
   b = inumb;
   free_bit(sp, IMAP, b);
   if (b < sp->s_isearch) sp->s_isearch = b;
+  dirhash_drop(dev, inumb);	/* in case it was an indexed directory */
 }
 
 /*===========================================================================*
@@ -220,6 +290,37 @@ PUBLIC void update_times(register struct inode *rip)
   rip->i_update = 0;		/* they are all up-to-date now */
 }
 
+/*===========================================================================*
+ *				mark_atime				     *
+ *===========================================================================*/
+/* inode that was read */
+PUBLIC void mark_atime(register struct inode *rip)
+{
+/* Mark the atime for update after a read. With MS_NOATIME it never is; with
+ * MS_RELATIME only if it is not newer than the last change, or a day old,
+ * judged by fs_time so that a read costs no clock call. With MS_LAZYTIME the
+ * atime is set now, but the inode is not dirtied; it is written when the slot
+ * is reused or the file system is synced.
+ */
+  struct super_block *sp;
+
+  sp = rip->i_sp;
+  if (sp->s_rd_only || (sp->s_flags & MS_NOATIME)) return;
+  if (rip->i_update & ATIME) return;		/* already marked */
+  if ((sp->s_flags & MS_RELATIME) && !(rip->i_update & (CTIME | MTIME)) &&
+	rip->i_atime > rip->i_mtime && rip->i_atime > rip->i_ctime &&
+	fs_time - rip->i_atime < RELATIME_AGE) return;
+  if (sp->s_flags & MS_LAZYTIME) {
+	/* Ask the clock the first time; later reads make do with fs_time. */
+	if (!rip->i_lazy) (void) clock_time();
+	if (fs_time > rip->i_atime) rip->i_atime = fs_time;
+	rip->i_lazy = TRUE;
+	return;
+  }
+  rip->i_update |= ATIME;
+  rip->i_dirt = DIRTY;
+}
+
 /*===========================================================================*
  *				rw_inode				     *
  *===========================================================================*/
@@ -230,17 +331,101 @@ PUBLIC void rw_inode(register struct inode *rip, int rw_flag)
 /* An entry in the inode table is to be copied to or from the disk. */
 
   register struct buf *bp;
+
+  /* Get the block where the inode resides. */
+  rip->i_sp = get_super(rip->i_dev);	/* inode must contain super block ptr */
+  bp = get_block(rip->i_dev, inode_blocknr(rip), NORMAL);
+  icopy(rip, bp, rw_flag);
+  put_block(bp, INODE_BLOCK);
+}
+
+/*===========================================================================*
+ *				inode_blocknr				     *
+ *===========================================================================*/
+/* inode whose block is wanted */
+PUBLIC block_t inode_blocknr(struct inode *rip)
+{
+/* Return the number of the block the inode is in. I_sp must be valid. */
+  register struct super_block *sp = rip->i_sp;
+
+  return((block_t) (rip->i_num - 1)/sp->s_inodes_per_block +
+  	sp->s_imap_blocks + sp->s_zmap_blocks + 2);
+}
+
+/*===========================================================================*
+ *				prefetch_inodes				     *
+ *===========================================================================*/
+/* directory being read */
+/* one of its blocks */
+PUBLIC void prefetch_inodes(struct inode *dirp, struct buf *dbp)
+{
+/* A program reading a directory, such as ls -l or find, is likely to stat
+ * every entry next. Get the inode blocks of the entries in this directory
+ * block that are not cached yet, with one read per run of adjacent blocks.
+ */
+  static struct buf *read_q[NR_IOREQS];
+  register struct direct *dp;
   register struct super_block *sp;
-  d1_inode *dip;
-  d2_inode *dip2;
+  struct bufclass *bc;
+  struct buf *bp;
   block_t b, offset;
+  ino_t ino;
+  int i, j, n;
 
-  /* Get the block where the inode resides. */
-  sp = get_super(rip->i_dev);	/* get pointer to super block */
-  rip->i_sp = sp;		/* inode must contain super block pointer */
+  sp = dirp->i_sp;
   offset = sp->s_imap_blocks + sp->s_zmap_blocks + 2;
-  b = (block_t) (rip->i_num - 1)/sp->s_inodes_per_block + offset;
-  bp = get_block(rip->i_dev, b, NORMAL);
+  n = 0;
+  for (dp = &dbp->b_dir[0];
+       dp < &dbp->b_dir[NR_DIR_ENTRIES(sp->s_block_size)] && n < NR_IOREQS;
+       dp++) {
+	if (dp->d_ino == 0) continue;
+	ino = conv4(sp->s_native, (int) dp->d_ino);
+	if (ino > sp->s_ninodes) continue;
+	b = (block_t) (ino - 1)/sp->s_inodes_per_block + offset;
+	for (i = 0; i < n && read_q[i]->b_blocknr != b; i++) {}
+	if (i < n) continue;		/* already asked for */
+
+	/* Don't trash the cache, leave 4 free. */
+	bc = BUF_CLASS(dbp);
+	if (bc->bc_in_use >= bc->bc_count - 4) break;
+
+	bp = get_block(dirp->i_dev, b, PREFETCH);
+	if (bp->b_dev != NO_DEV) {
+		put_block(bp, INODE_BLOCK);	/* it is in the cache */
+		continue;
+	}
+	read_q[n++] = bp;
+  }
+
+  /* Sort the blocks. Rw_scattered() reads only the first run of adjacent
+   * ones, so give it the runs one by one.
+   */
+  for (i = 1; i < n; i++) {
+	bp = read_q[i];
+	for (j = i; j > 0 && read_q[j-1]->b_blocknr > bp->b_blocknr; j--)
+		read_q[j] = read_q[j-1];
+	read_q[j] = bp;
+  }
+  for (i = 0; i < n; i += j) {
+	for (j = 1; i + j < n && read_q[i+j]->b_blocknr ==
+				read_q[i]->b_blocknr + j; j++) {}
+	rw_scattered(dirp->i_dev, read_q + i, j, READING);
+  }
+}
+
+/*===========================================================================*
+ *				icopy					     *
+ *===========================================================================*/
+/* pointer to inode to be read/written */
+/* the block it is in */
+/* READING or WRITING */
+PRIVATE void icopy(register struct inode *rip, struct buf *bp, int rw_flag)
+{
+/* Copy an inode between the inode table and its block in the cache. */
+  register struct super_block *sp = rip->i_sp;
+  d1_inode *dip;
+  d2_inode *dip2;
+
   dip  = bp->b_v1_ino + (rip->i_num - 1) % V1_INODES_PER_BLOCK;
   dip2 = bp->b_v2_ino + (rip->i_num - 1) %
   	 V2_INODES_PER_BLOCK(sp->s_block_size);
@@ -258,9 +443,8 @@ PUBLIC void rw_inode(register struct inode *rip, int rw_flag)
 	old_icopy(rip, dip,  rw_flag, sp->s_native);
   else
 	new_icopy(rip, dip2, rw_flag, sp->s_native);
-  
-  put_block(bp, INODE_BLOCK);
   rip->i_dirt = CLEAN;
+  rip->i_lazy = FALSE;
 }
 
 /*===========================================================================*
@@ -289,6 +473,7 @@ PRIVATE void old_icopy(register struct inode *rip, register d1_inode *dip, int d
 	rip->i_mtime   = conv4(norm,       dip->d1_mtime);
 	rip->i_atime   = rip->i_mtime;
 	rip->i_ctime   = rip->i_mtime;
+	rip->i_inline  = FALSE;
 	rip->i_nlinks  = dip->d1_nlinks;		/* 1 char */
 	rip->i_gid     = dip->d1_gid;			/* 1 char */
 	rip->i_ndzones = V1_NR_DZONES;
@@ -317,36 +502,51 @@ PRIVATE void old_icopy(register struct inode *rip, register d1_inode *dip, int d
 /* TRUE = do not swap bytes; FALSE = swap */
 PRIVATE void new_icopy(register struct inode *rip, register d2_inode *dip, int direction, int norm)
 {
-/* Same as old_icopy, but to/from V2 disk layout. */
+/* Same as old_icopy, but to/from V2 disk layout. The data of an inline file
+ * is copied as it is, without swapping bytes.
+ */
 
-  int i;
+  int i, gid;
 
   if (direction == READING) {
 	/* Copy V2.x inode to the in-core table, swapping bytes if need be. */
 	rip->i_mode    = conv2(norm,dip->d2_mode);
 	rip->i_uid     = conv2(norm,dip->d2_uid);
 	rip->i_nlinks  = conv2(norm,dip->d2_nlinks);
-	rip->i_gid     = conv2(norm,dip->d2_gid);
+	gid            = conv2(norm,dip->d2_gid);
+	rip->i_gid     = gid;
 	rip->i_size    = conv4(norm,dip->d2_size);
 	rip->i_atime   = conv4(norm,dip->d2_atime);
 	rip->i_ctime   = conv4(norm,dip->d2_ctime);
 	rip->i_mtime   = conv4(norm,dip->d2_mtime);
 	rip->i_ndzones = V2_NR_DZONES;
 	rip->i_nindirs = V2_INDIRECTS(rip->i_sp->s_block_size);
-	for (i = 0; i < V2_NR_TZONES; i++)
-		rip->i_zone[i] = conv4(norm, (long) dip->d2_zone[i]);
+	rip->i_inline  = (rip->i_sp->s_version == V3 &&
+					(gid & DI_FLAGS) == DI_INLINE);
+	if (rip->i_inline) {
+		memcpy((char *) rip->i_zone, (char *) dip->d2_zone, INLINE_MAX);
+	} else {
+		for (i = 0; i < V2_NR_TZONES; i++)
+			rip->i_zone[i] = conv4(norm, (long) dip->d2_zone[i]);
+	}
   } else {
 	/* Copying V2.x inode to disk from the in-core table. */
+	gid = rip->i_gid;
+	if (rip->i_inline) gid = (gid & BYTE) | DI_INLINE;
 	dip->d2_mode   = conv2(norm,rip->i_mode);
 	dip->d2_uid    = conv2(norm,rip->i_uid);
 	dip->d2_nlinks = conv2(norm,rip->i_nlinks);
-	dip->d2_gid    = conv2(norm,rip->i_gid);
+	dip->d2_gid    = conv2(norm,gid);
 	dip->d2_size   = conv4(norm,rip->i_size);
 	dip->d2_atime  = conv4(norm,rip->i_atime);
 	dip->d2_ctime  = conv4(norm,rip->i_ctime);
 	dip->d2_mtime  = conv4(norm,rip->i_mtime);
-	for (i = 0; i < V2_NR_TZONES; i++)
-		dip->d2_zone[i] = conv4(norm, (long) rip->i_zone[i]);
+	if (rip->i_inline) {
+		memcpy((char *) dip->d2_zone, (char *) rip->i_zone, INLINE_MAX);
+	} else {
+		for (i = 0; i < V2_NR_TZONES; i++)
+			dip->d2_zone[i] = conv4(norm, (long) rip->i_zone[i]);
+	}
   }
 }
 
@@ -362,3 +562,14 @@ PUBLIC void dup_inode(struct inode *ip)
 
   ip->i_count++;
 }
+
+/*===========================================================================*
+ *				inode_timeout				     *
+ *===========================================================================*/
+/* the inode write-back timer */
+PRIVATE void inode_timeout(timer_t *tp)
+{
+/* Released dirty inodes have waited long enough; write them back. */
+  itimer_set = FALSE;
+  flush_inodes(FALSE);
+}
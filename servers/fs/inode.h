@@ -31,6 +31,8 @@ EXTERN struct inode {
   char i_mount;			/* this bit is set if file mounted on */
   char i_seek;			/* set on LSEEK, cleared on READ/WRITE */
   char i_update;		/* the ATIME, CTIME, and MTIME bits are here */
+  char i_inline;		/* TRUE if the data is in i_zone (V3 only) */
+  char i_lazy;			/* TRUE if i_atime is newer than on the disk */
 } inode[NR_INODES];
 
 #define NIL_INODE (struct inode *) 0	/* indicates absence of inode slot */
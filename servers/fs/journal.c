@@ -0,0 +1,583 @@
+/* This file implements the metadata journal of V3 file systems. A file system
+ * has a journal if its super block gives the place and size of one. Inode,
+ * directory, indirect and bit map blocks that are dirtied are then collected
+ * in an open transaction, instead of being written to their home location
+ * right away. A transaction is committed by writing a descriptor block, the
+ * blocks themselves, and a commit block to the journal in one go; only then
+ * may the blocks go home, which happens lazily, as the cache decides. When
+ * the journal fills up, or on sync(), everything is written home and the
+ * journal starts over from the beginning; this is the checkpoint.
+ *
+ * Transactions are committed in batches: when one is half full at the end of
+ * a call, when it is JOURNAL_DELAY seconds old, or when one of its blocks has
+ * to be written home. At mount, committed transactions are replayed, so the
+ * metadata on the disk is that of the last commit.
+ *
+ * The journal on the disk starts with a header block telling where the first
+ * transaction to replay is and which sequence number it has. A transaction
+ * is valid if its descriptor and commit block both have the expected number,
+ * and the checksum in the commit block matches.
+ *
+ * When a zone is freed, a directory or indirect block of it may still be in
+ * the journal. The transaction then revokes its blocks: copies of them in it
+ * or in earlier transactions are not replayed, as the zone may hold something
+ * else by then. A revoked block is not written home before the revoke is
+ * committed.
+ *
+ * The entry points into this file are
+ *   journal_add:	 add a dirty metadata block to the open transaction
+ *   journal_commit:	 commit the open transaction of a device
+ *   journal_check:	 commit transactions that have grown large enough
+ *   journal_checkpoint: write everything home and empty the journal
+ *   journal_replay:	 replay the journal of a file system being mounted
+ *   journal_revoke:	 void the copies in the journal of a freed zone
+ *   journal_write:	 commit revokes before blocks are written home
+ *   journal_create:	 make a journal for a file system
+ */
+
+#include "fs.h"
+#include <string.h>
+#include <timers.h>
+#include <minix/com.h>
+#include "buf.h"
+#include "super.h"
+#include "const.h"
+
+PRIVATE union jblock {
+  jheader_t h;
+  jdesc_t d;
+  char b[MAX_MOUNT_BLOCK_SIZE];
+} jdesc, jcommit;			/* descriptor and commit block */
+
+PRIVATE timer_t jtimer;			/* commits transactions that idle */
+PRIVATE int jtimer_set;			/* TRUE if the timer is running */
+
+PRIVATE struct jrevoked {
+  block_t jr_block;			/* block revoked */
+  u32_t jr_seq;				/* by the transaction with this number */
+} jrevoked[JREVOKE_TOTAL];		/* revokes found by a replay */
+PRIVATE int jnrevoked;			/* how many */
+
+FORWARD _PROTOTYPE( struct super_block *jsuper, (Dev_t dev)		);
+FORWARD _PROTOTYPE( u32_t jsum, (u32_t sum, char *data, int size)	);
+FORWARD _PROTOTYPE( int write_header, (struct super_block *sp)		);
+FORWARD _PROTOTYPE( int replay_check, (struct super_block *sp, block_t pos,
+						u32_t seq, int *count)	);
+FORWARD _PROTOTYPE( void replay_copy, (struct super_block *sp, block_t pos,
+						u32_t seq, int *count)	);
+FORWARD _PROTOTYPE( void journal_timeout, (timer_t *tp)			);
+
+/*===========================================================================*
+ *				journal_add				     *
+ *===========================================================================*/
+/* dirty block being released */
+/* INODE_BLOCK, DIRECTORY_BLOCK, or whatever */
+PUBLIC void journal_add(struct buf *bp, int block_type)
+{
+/* A dirty block is released. If it holds metadata of a file system with a
+ * journal, add it to the open transaction of that file system.
+ */
+  register struct super_block *sp;
+  int i;
+
+  block_type &= ~(WRITE_IMMED | ONE_SHOT);
+  if (block_type != INODE_BLOCK && block_type != DIRECTORY_BLOCK &&
+      block_type != INDIRECT_BLOCK && block_type != MAP_BLOCK) return;
+  if ( (sp = jsuper(bp->b_dev)) == NIL_SUPER) return;
+
+  /* A block of a freed zone is in use again; this copy is to be replayed. */
+  for (i = 0; i < sp->s_jnrevoke; i++) {
+	if (sp->s_jrevoke[i] == bp->b_blocknr) {
+		sp->s_jrevoke[i] = sp->s_jrevoke[--sp->s_jnrevoke];
+		break;
+	}
+  }
+  if (bp->b_journal) return;		/* in the transaction already */
+  if (bp->b_blocknr >= (block_t) sp->s_firstdatazone << sp->s_log_zone_size)
+	sp->s_jdata = TRUE;
+
+  /* A full transaction must be committed now, even in the middle of a call. */
+  if (sp->s_jcount == JTRANS_MAX) journal_commit(sp->s_dev);
+
+  sp->s_jbuf[sp->s_jcount++] = bp;
+  bp->b_journal = TRUE;
+
+  /* Make sure the transaction gets committed if nothing else happens. */
+  if (!jtimer_set) {
+	fs_init_timer(&jtimer);
+	fs_set_timer(&jtimer, JOURNAL_DELAY * HZ, journal_timeout, 0);
+	jtimer_set = TRUE;
+  }
+}
+
+/*===========================================================================*
+ *				journal_commit				     *
+ *===========================================================================*/
+/* device whose transaction to commit */
+PUBLIC void journal_commit(dev_t dev)
+{
+/* Write the open transaction of a device to its journal. The blocks stay
+ * dirty in the cache, and go home later.
+ */
+  register struct super_block *sp;
+  register struct buf *bp;
+  static iovec_t iovec[NR_IOREQS];	/* static so it isn't on stack */
+  u32_t sum;
+  int i, n, r, block_size;
+
+  if ( (sp = jsuper(dev)) == NIL_SUPER) return;
+  if (sp->s_jcount == 0 && sp->s_jnrevoke == 0) return;
+  n = sp->s_jcount;
+  sp->s_jcount = 0;
+  block_size = sp->s_block_size;
+
+  /* Build the descriptor, and an I/O vector for the whole transaction. */
+  memset(jdesc.b, 0, block_size);
+  jdesc.d.jd_magic = JD_MAGIC;
+  jdesc.d.jd_seq = sp->s_jseq;
+  jdesc.d.jd_count = n;
+  jdesc.d.jd_nrevoke = sp->s_jnrevoke;
+  for (i = 0; i < sp->s_jnrevoke; i++) jdesc.d.jd_revoke[i] = sp->s_jrevoke[i];
+  sp->s_jnrevoke = 0;
+  iovec[0].iov_addr = (vir_bytes) jdesc.b;
+  iovec[0].iov_size = block_size;
+  for (i = 0; i < n; i++) {
+	bp = sp->s_jbuf[i];
+	bp->b_journal = FALSE;
+	jdesc.d.jd_block[i] = bp->b_blocknr;
+	iovec[1 + i].iov_addr = (vir_bytes) bp->b_data;
+	iovec[1 + i].iov_size = block_size;
+  }
+
+  /* The commit block has the checksum of the rest. */
+  sum = jsum(0, jdesc.b, block_size);
+  for (i = 0; i < n; i++) sum = jsum(sum, sp->s_jbuf[i]->b_data, block_size);
+  jcommit = jdesc;
+  jcommit.d.jd_magic = JC_MAGIC;
+  jcommit.d.jd_sum = sum;
+  iovec[1 + n].iov_addr = (vir_bytes) jcommit.b;
+  iovec[1 + n].iov_size = block_size;
+
+  r = dev_io(DEV_SCATTER, dev, FS_PROC_NR, iovec,
+	(off_t) (sp->s_jstart + sp->s_jnext) * block_size, n + 2, 0);
+  if (r != OK || iovec[1 + n].iov_size != 0) {
+	/* The blocks are still dirty and will go home without a journal, so
+	 * older transactions must not be replayed over them. Write everything
+	 * home and start over; the sequence number skips the one of the
+	 * broken transaction, so no part of it can match the new header. If
+	 * it was the first one, there is nothing older; the header will do.
+	 */
+	printf("fs: cannot write journal on device %d/%d\n",
+		(dev>>MAJOR)&BYTE, (dev>>MINOR)&BYTE);
+	sp->s_jseq++;
+	if (sp->s_jnext == 1) (void) write_header(sp);
+	else journal_checkpoint(sp);
+	return;
+  }
+  sp->s_jnext += n + 2;
+  sp->s_jseq++;
+
+  /* Keep room for the largest transaction. */
+  if (sp->s_jnext + JTRANS_MAX + 2 > sp->s_jblocks) journal_checkpoint(sp);
+}
+
+/*===========================================================================*
+ *				journal_check				     *
+ *===========================================================================*/
+PUBLIC void journal_check()
+{
+/* A call has been done. Commit the transactions that are half full now,
+ * while no call is halfway, so that a transaction holds whole calls.
+ */
+  register struct super_block *sp;
+
+  for (sp = &super_block[0]; sp < &super_block[NR_SUPERS]; sp++)
+	if (sp->s_dev != NO_DEV && sp->s_jcount >= JTRANS_MAX / 2)
+		journal_commit(sp->s_dev);
+}
+
+/*===========================================================================*
+ *				journal_checkpoint			     *
+ *===========================================================================*/
+/* file system whose journal to empty */
+PUBLIC void journal_checkpoint(struct super_block *sp)
+{
+/* Commit the open transaction and write all dirty blocks home; the journal
+ * is no longer needed and starts over. An empty journal is left alone.
+ */
+  if (sp->s_jblocks == 0 || sp->s_rd_only) return;
+  if (sp->s_jnext == 1 && sp->s_jcount == 0 && sp->s_jnrevoke == 0) return;
+  journal_commit(sp->s_dev);
+  flushall(sp->s_dev);
+  sp->s_jnext = 1;
+  sp->s_jdata = FALSE;
+  sp->s_jrevokes = 0;
+  (void) write_header(sp);
+}
+
+/*===========================================================================*
+ *				journal_replay				     *
+ *===========================================================================*/
+/* file system being mounted */
+PUBLIC void journal_replay(struct super_block *sp)
+{
+/* A file system with a journal is mounted. Copy the blocks of all committed
+ * transactions to their home locations, then start an empty journal. Nothing
+ * may be written to a read-only file system; it is mounted as it is on the
+ * disk, without its journal.
+ */
+  struct buf *bp;
+  jheader_t *hp;
+  block_t pos, start, dev_blocks;
+  u32_t seq, first;
+  int count, replayed, i;
+
+  sp->s_jcount = 0;
+  sp->s_jdata = FALSE;
+  sp->s_jnrevoke = 0;
+  sp->s_jrevokes = 0;
+  if (sp->s_jblocks == 0) return;
+
+  /* Don't trust a journal that is not where the data zones are. */
+  dev_blocks = (block_t) sp->s_zones << sp->s_log_zone_size;
+  if (sp->s_jstart < ((block_t) sp->s_firstdatazone << sp->s_log_zone_size)
+	|| sp->s_jblocks < JTRANS_MAX + 3
+	|| sp->s_jstart + sp->s_jblocks > dev_blocks) {
+	printf("fs: bad journal on device %d/%d ignored\n",
+		(sp->s_dev>>MAJOR)&BYTE, (sp->s_dev>>MINOR)&BYTE);
+	sp->s_jblocks = 0;
+	return;
+  }
+
+  bp = get_block(sp->s_dev, sp->s_jstart, NORMAL);
+  hp = (jheader_t *) bp->b_data;
+  first = seq = hp->jh_seq;
+  start = pos = hp->jh_start;
+  if (hp->jh_magic != JH_MAGIC) pos = sp->s_jblocks;	/* nothing to do */
+  put_block(bp, FULL_DATA_BLOCK);
+
+  jnrevoked = 0;
+  if (sp->s_rd_only) {
+	if (replay_check(sp, pos, seq, &count)) {
+		printf("fs: journal on read-only device %d/%d not replayed\n",
+			(sp->s_dev>>MAJOR)&BYTE, (sp->s_dev>>MINOR)&BYTE);
+	}
+	invalidate(sp->s_dev);
+	sp->s_jblocks = 0;
+	return;
+  }
+
+  /* Find the complete transactions and what they revoke, then copy them. */
+  for (replayed = 0; replay_check(sp, pos, seq, &count); replayed++) {
+	pos += count + 2;
+	seq++;
+  }
+  pos = start;
+  seq = first;
+  for (i = 0; i < replayed; i++) {
+	replay_copy(sp, pos, seq, &count);
+	pos += count + 2;
+	seq++;
+  }
+  if (replayed > 0) {
+	printf("fs: replayed %d journal transaction%s on device %d/%d\n",
+		replayed, replayed == 1 ? "" : "s",
+		(sp->s_dev>>MAJOR)&BYTE, (sp->s_dev>>MINOR)&BYTE);
+  }
+  flushall(sp->s_dev);
+
+  /* Forget the journal blocks read; commits don't go through the cache. */
+  invalidate(sp->s_dev);
+
+  sp->s_jseq = seq;
+  sp->s_jnext = 1;
+  (void) write_header(sp);
+}
+
+/*===========================================================================*
+ *				journal_revoke				     *
+ *===========================================================================*/
+/* file system of the zone */
+/* zone being freed */
+PUBLIC void journal_revoke(struct super_block *sp, zone_t zone)
+{
+/* A zone is freed. If the journal may hold directory or indirect blocks, the
+ * open transaction revokes the blocks of the zone. When too many blocks have
+ * been revoked for a replay to keep track of, the journal is emptied instead.
+ */
+  block_t b, end;
+
+  if (sp->s_jblocks == 0 || !sp->s_jdata) return;
+  b = (block_t) zone << sp->s_log_zone_size;
+  end = b + (1 << sp->s_log_zone_size);
+  for ( ; b < end; b++) {
+	if (sp->s_jrevokes == JREVOKE_TOTAL) {
+		journal_checkpoint(sp);
+		return;
+	}
+	if (sp->s_jnrevoke == JREVOKE_MAX) journal_commit(sp->s_dev);
+	if (!sp->s_jdata) return;	/* the commit made a checkpoint */
+	sp->s_jrevoke[sp->s_jnrevoke++] = b;
+	sp->s_jrevokes++;
+  }
+}
+
+/*===========================================================================*
+ *				journal_write				     *
+ *===========================================================================*/
+/* device about to be written */
+/* first block to be written */
+/* number of blocks */
+PUBLIC void journal_write(Dev_t dev, block_t block, int count)
+{
+/* Blocks are about to be written home. If the open transaction revokes one of
+ * them, commit it first, or a replay could put an old copy over them.
+ */
+  register struct super_block *sp;
+  int i;
+
+  if ( (sp = jsuper(dev)) == NIL_SUPER || sp->s_jnrevoke == 0) return;
+  for (i = 0; i < sp->s_jnrevoke; i++) {
+	if (sp->s_jrevoke[i] >= block && sp->s_jrevoke[i] < block + count) {
+		journal_commit(dev);
+		return;
+	}
+  }
+}
+
+/*===========================================================================*
+ *				journal_create				     *
+ *===========================================================================*/
+/* file system to give a journal */
+PUBLIC int journal_create(struct super_block *sp)
+{
+/* Allocate JOURNAL_BLOCKS worth of contiguous zones for a journal, and note
+ * them in the super block. The zones stay allocated in the bit map, so the
+ * file system won't use them for anything else.
+ */
+  static union {
+	struct super_block s;
+	char b[MIN_BLOCK_SIZE];
+  } sb;
+  bit_t start, b = NO_BIT;
+  zone_t want, len;
+  int scale;
+
+  if (sp->s_version != V3 || sp->s_rd_only) return(EINVAL);
+  if (sp->s_jblocks != 0) return(OK);		/* there is one already */
+
+  /* Find a run of free zones. Alloc_bit() wraps around at the end. */
+  scale = sp->s_log_zone_size;
+  want = (JOURNAL_BLOCKS + (1 << scale) - 1) >> scale;
+  len = 0;
+  start = alloc_bit(sp, ZMAP, sp->s_zsearch);
+  if (start != NO_BIT) len = 1;
+  while (start != NO_BIT && len < want) {
+	b = alloc_bit(sp, ZMAP, start + len);
+	if (b == start + len) {
+		len++;
+		continue;
+	}
+	while (len > 0) free_bit(sp, ZMAP, start + --len);
+	start = (b > start ? b : NO_BIT);	/* give up after wrapping */
+	if (start != NO_BIT) len = 1;
+  }
+  if (start == NO_BIT) {
+	if (b != NO_BIT) free_bit(sp, ZMAP, b);
+	printf("fs: no room for a journal on device %d/%d\n",
+		(sp->s_dev>>MAJOR)&BYTE, (sp->s_dev>>MINOR)&BYTE);
+	return(ENOSPC);
+  }
+
+  /* The bit map must be on the disk before the super block points there. */
+  flushall(sp->s_dev);
+  sp->s_jstart = (block_t) (sp->s_firstdatazone - 1 + start) << scale;
+  sp->s_jblocks = (block_t) len << scale;
+  sp->s_jseq = 1;
+  sp->s_jnext = 1;
+  if (write_header(sp) != OK ||
+      dev_io(DEV_READ, sp->s_dev, FS_PROC_NR, sb.b, SUPER_BLOCK_BYTES,
+		MIN_BLOCK_SIZE, 0) != MIN_BLOCK_SIZE) {
+	sp->s_jblocks = 0;
+	return(EIO);
+  }
+  sb.s.s_jstart = sp->s_jstart;
+  sb.s.s_jblocks = sp->s_jblocks;
+  if (dev_io(DEV_WRITE, sp->s_dev, FS_PROC_NR, sb.b, SUPER_BLOCK_BYTES,
+		MIN_BLOCK_SIZE, 0) != MIN_BLOCK_SIZE) {
+	sp->s_jblocks = 0;
+	return(EIO);
+  }
+  return(OK);
+}
+
+/*===========================================================================*
+ *				jsuper					     *
+ *===========================================================================*/
+/* device to look for */
+PRIVATE struct super_block *jsuper(dev_t dev)
+{
+/* Return the super block of a device if it has a journal. */
+  register struct super_block *sp;
+
+  for (sp = &super_block[0]; sp < &super_block[NR_SUPERS]; sp++)
+	if (sp->s_dev == dev) return(sp->s_jblocks != 0 ? sp : NIL_SUPER);
+  return(NIL_SUPER);
+}
+
+/*===========================================================================*
+ *				jsum					     *
+ *===========================================================================*/
+/* checksum so far */
+/* block to add to it */
+/* block size */
+PRIVATE u32_t jsum(u32_t sum, char *data, int size)
+{
+  register u32_t *wp, *wlim;
+
+  wlim = (u32_t *) (data + size);
+  for (wp = (u32_t *) data; wp < wlim; wp++)
+	sum = ((sum << 1) | (sum >> 31)) + *wp;
+  return(sum);
+}
+
+/*===========================================================================*
+ *				write_header				     *
+ *===========================================================================*/
+/* file system whose journal header to write */
+PRIVATE int write_header(struct super_block *sp)
+{
+/* Write the journal header: transactions to replay start at s_jnext. */
+  memset(jdesc.b, 0, sp->s_block_size);
+  jdesc.h.jh_magic = JH_MAGIC;
+  jdesc.h.jh_seq = sp->s_jseq;
+  jdesc.h.jh_start = sp->s_jnext;
+  if (dev_io(DEV_WRITE, sp->s_dev, FS_PROC_NR, jdesc.b,
+	(off_t) sp->s_jstart * sp->s_block_size, sp->s_block_size, 0)
+						!= sp->s_block_size) {
+	printf("fs: cannot write journal header on device %d/%d\n",
+		(sp->s_dev>>MAJOR)&BYTE, (sp->s_dev>>MINOR)&BYTE);
+	return(EIO);
+  }
+  return(OK);
+}
+
+/*===========================================================================*
+ *				replay_check				     *
+ *===========================================================================*/
+/* file system being mounted */
+/* where the transaction should be */
+/* sequence number it should have */
+/* number of blocks in it */
+PRIVATE int replay_check(struct super_block *sp, block_t pos, u32_t seq,
+								int *count)
+{
+/* Tell whether a transaction is there and complete, and note the blocks it
+ * revokes.
+ */
+  static block_t revoke[JREVOKE_MAX];
+  struct buf *bp;
+  jdesc_t *dp;
+  block_t jpos, dev_blocks;
+  u32_t sum;
+  int i, n, nrev, ok, block_size;
+
+  if (pos + 2 > sp->s_jblocks) return(FALSE);
+  jpos = sp->s_jstart + pos;
+  block_size = sp->s_block_size;
+  dev_blocks = (block_t) sp->s_zones << sp->s_log_zone_size;
+
+  /* Check the descriptor, and remember what it revokes. */
+  bp = get_block(sp->s_dev, jpos, NORMAL);
+  dp = (jdesc_t *) bp->b_data;
+  n = dp->jd_count;
+  nrev = dp->jd_nrevoke;
+  ok = (dp->jd_magic == JD_MAGIC && dp->jd_seq == seq
+		&& n <= JTRANS_MAX && pos + n + 2 <= sp->s_jblocks
+		&& nrev <= JREVOKE_MAX && jnrevoked + nrev <= JREVOKE_TOTAL);
+  for (i = 0; ok && i < n; i++) {
+	if (dp->jd_block[i] >= dev_blocks || (dp->jd_block[i] >= sp->s_jstart
+		&& dp->jd_block[i] < sp->s_jstart + sp->s_jblocks)) ok = FALSE;
+  }
+  for (i = 0; ok && i < nrev; i++) revoke[i] = dp->jd_revoke[i];
+  sum = jsum(0, bp->b_data, block_size);
+  put_block(bp, FULL_DATA_BLOCK);
+  if (!ok) return(FALSE);
+
+  /* The commit block must be there, with the checksum of the rest. */
+  for (i = 1; i <= n; i++) {
+	bp = get_block(sp->s_dev, jpos + i, NORMAL);
+	sum = jsum(sum, bp->b_data, block_size);
+	put_block(bp, FULL_DATA_BLOCK);
+  }
+  bp = get_block(sp->s_dev, jpos + n + 1, NORMAL);
+  dp = (jdesc_t *) bp->b_data;
+  ok = (dp->jd_magic == JC_MAGIC && dp->jd_seq == seq && dp->jd_count == n
+		&& dp->jd_sum == sum);
+  put_block(bp, FULL_DATA_BLOCK);
+  if (!ok) return(FALSE);
+
+  for (i = 0; i < nrev; i++) {
+	jrevoked[jnrevoked].jr_block = revoke[i];
+	jrevoked[jnrevoked].jr_seq = seq;
+	jnrevoked++;
+  }
+  *count = n;
+  return(TRUE);
+}
+
+/*===========================================================================*
+ *				replay_copy				     *
+ *===========================================================================*/
+/* file system being mounted */
+/* where the transaction is */
+/* its sequence number */
+/* number of blocks in it */
+PRIVATE void replay_copy(struct super_block *sp, block_t pos, u32_t seq,
+								int *count)
+{
+/* Copy the blocks of a complete transaction home, except those revoked by it
+ * or a later transaction.
+ */
+  static block_t home[JTRANS_MAX];
+  struct buf *bp, *hbp;
+  jdesc_t *dp;
+  block_t jpos;
+  int i, k, n;
+
+  jpos = sp->s_jstart + pos;
+  bp = get_block(sp->s_dev, jpos, NORMAL);
+  dp = (jdesc_t *) bp->b_data;
+  n = dp->jd_count;
+  for (i = 0; i < n; i++) home[i] = dp->jd_block[i];
+  put_block(bp, FULL_DATA_BLOCK);
+
+  for (i = 0; i < n; i++) {
+	for (k = 0; k < jnrevoked; k++) {
+		if (jrevoked[k].jr_block == home[i]
+					&& jrevoked[k].jr_seq >= seq) break;
+	}
+	if (k < jnrevoked) continue;
+	bp = get_block(sp->s_dev, jpos + 1 + i, NORMAL);
+	hbp = get_block(sp->s_dev, home[i], NO_READ);
+	memcpy(hbp->b_data, bp->b_data, (size_t) sp->s_block_size);
+	hbp->b_dirt = DIRTY;
+	put_block(bp, FULL_DATA_BLOCK);
+	put_block(hbp, FULL_DATA_BLOCK);
+  }
+  *count = n;
+}
+
+/*===========================================================================*
+ *				journal_timeout				     *
+ *===========================================================================*/
+/* the journal timer */
+PRIVATE void journal_timeout(timer_t *tp)
+{
+/* Transactions have been open for JOURNAL_DELAY seconds; commit them. */
+  register struct super_block *sp;
+
+  jtimer_set = FALSE;
+  for (sp = &super_block[0]; sp < &super_block[NR_SUPERS]; sp++)
+	if (sp->s_dev != NO_DEV && sp->s_jcount > 0) journal_commit(sp->s_dev);
+}
@@ -328,6 +328,14 @@ PUBLIC void truncate(register struct inode *rip)
 
   file_type = rip->i_mode & I_TYPE;	/* check to see if file is special */
   if (file_type == I_CHAR_SPECIAL || file_type == I_BLOCK_SPECIAL) return;
+
+  /* An inline file has no zones; its data goes with the zone numbers. */
+  if (rip->i_inline) {
+	for (i = 0; i < V2_NR_TZONES; i++) rip->i_zone[i] = NO_ZONE;
+	rip->i_inline = FALSE;
+	rip->i_dirt = DIRTY;
+	return;
+  }
   dev = rip->i_dev;		/* device on which inode resides */
   scale = rip->i_sp->s_log_zone_size;
   zone_size = (zone_t) rip->i_sp->s_block_size << scale;
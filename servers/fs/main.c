@@ -21,6 +21,7 @@ struct super_block;		/* proto.h needs to know this */
 #include <minix/callnr.h>
 #include <minix/com.h>
 #include <minix/keymap.h>
+#include <minix/trace.h>
 #include <minix/const.h>
 #include "buf.h"
 #include "file.h"
@@ -67,9 +68,13 @@ PUBLIC int main()
         	/* Not a user request; system has expired one of our timers,
         	 * currently only in use for select(). Check it.
         	 */
+        	fs_time = (time_t) (boottime + m_in.NOTIFY_TIMESTAMP/HZ);
         	fs_expire_timers(m_in.NOTIFY_TIMESTAMP);
         } else if ((call_nr & NOTIFY_MESSAGE)) {
-        	/* Device notifies us of an event. */
+        	/* Device notifies us of an event. LOG also notifies us when
+        	 * the mask of trace classes changes.
+        	 */
+        	if (who == LOG_PROC_NR) trace_update();
         	dev_status(&m_in);
         } else {
 		/* Call the internal function that does the work. */
@@ -86,6 +91,8 @@ PUBLIC int main()
 
 		/* Copy the results back to the user and send reply. */
 		if (error != SUSPEND) { reply(who, error); }
+		journal_check();	/* commit large transactions */
+		discard_flush();	/* give freed RAM disk memory back */
 		if (rdahed_inode != NIL_INODE) {
 			read_ahead(); /* do block read ahead */
 		}
@@ -132,26 +139,40 @@ PRIVATE void get_work()
  *===========================================================================*/
 PRIVATE void buf_pool(void)
 {
-/* Initialize the buffer pool. */
+/* Initialize the buffer pool. The small and the large buffers each get an
+ * LRU chain of their own; all of them start out on hash chain 0.
+ */
 
   register struct buf *bp;
+  char *data;
 
   bufs_in_use = 0;
-  front = &buf[0];
-  rear = &buf[NR_BUFS - 1];
-
-  for (bp = &buf[0]; bp < &buf[NR_BUFS]; bp++) {
+  bufclass[SMALL_BUFS].bc_count = NR_BUFS;
+  bufclass[LARGE_BUFS].bc_count = NR_LBUFS;
+  bufclass[SMALL_BUFS].bc_front = &buf[0];
+  bufclass[SMALL_BUFS].bc_rear = &buf[NR_BUFS - 1];
+  bufclass[LARGE_BUFS].bc_front = NR_LBUFS > 0 ? &buf[NR_BUFS] : NIL_BUF;
+  bufclass[LARGE_BUFS].bc_rear = NR_LBUFS > 0 ? &buf[NR_ALL_BUFS-1] : NIL_BUF;
+
+  data = (char *) buf_space;
+  for (bp = &buf[0]; bp < &buf[NR_ALL_BUFS]; bp++) {
 	bp->b_blocknr = NO_BLOCK;
 	bp->b_dev = NO_DEV;
 	bp->b_next = bp + 1;
 	bp->b_prev = bp - 1;
+	bp->b_hash = bp + 1;
+	bp->b_bytes = bp < &buf[NR_BUFS] ? MAX_BLOCK_SIZE : MAX_LARGE_BLOCK_SIZE;
+	bp->b_blk = (union blkdata *) data;
+	data += bp->b_bytes;
   }
   buf[0].b_prev = NIL_BUF;
   buf[NR_BUFS - 1].b_next = NIL_BUF;
-
-  for (bp = &buf[0]; bp < &buf[NR_BUFS]; bp++) bp->b_hash = bp->b_next;
-  buf_hash[0] = front;
-
+  if (NR_LBUFS > 0) {
+	buf[NR_BUFS].b_prev = NIL_BUF;
+	buf[NR_ALL_BUFS - 1].b_next = NIL_BUF;
+  }
+  buf[NR_ALL_BUFS - 1].b_hash = NIL_BUF;
+  buf_hash[0] = &buf[0];
 }
 
 /*===========================================================================*
@@ -219,6 +240,8 @@ PRIVATE void fs_init()
   fp = (struct fproc *) NULL;
   who = FS_PROC_NR;
 
+  trace_init(TRS_FS);		/* records go to LOG as the FS source */
+
   buf_pool();			/* initialize buffer pool */
   build_dmap();			/* build device table and map boot driver */
   load_ram();			/* init RAM disk, load if it is root */
@@ -259,19 +282,18 @@ PRIVATE int igetenv(char *key, int optional)
 PRIVATE void load_ram(void)
 {
 /* Allocate a RAM disk with size given in the boot parameters. If a RAM disk 
- * image is given, the copy the entire image device block-by-block to a RAM 
+ * image is given, the copy the entire image device in large chunks to a RAM 
  * disk with the same size as the image.
  * If the root device is not set, the RAM disk will be used as root instead. 
  */
-  register struct buf *bp, *bp1;
   u32_t lcount, ram_size_kb;
   zone_t zones;
   struct super_block *sp, *dsp;
-  block_t b;
+  off_t pos, total;
   Dev_t image_dev;
   static char sbbuf[MIN_BLOCK_SIZE];
-  int block_size_image, block_size_ram, ramfs_block_size;
-  int s;
+  int ramfs_block_size;
+  int s, r, chunk;
 
   /* Get some boot environment variables. */
   root_dev = igetenv("rootdev", 0);
@@ -350,47 +372,34 @@ PRIVATE void load_ram(void)
   if (root_dev != DEV_RAM)
   	return;
 
-  /* Copy the blocks one at a time from the image to the RAM disk. */
-  printf("Loading RAM disk onto /dev/ram:\33[23CLoaded:    0 KB");
-
-  inode[0].i_mode = I_BLOCK_SPECIAL;	/* temp inode for rahead() */
-  inode[0].i_size = LONG_MAX;
-  inode[0].i_dev = image_dev;
-  inode[0].i_zone[0] = image_dev;
-
-  block_size_ram = get_block_size(DEV_RAM);
-  block_size_image = get_block_size(image_dev);
-
-  /* RAM block size has to be a multiple of the root image block
-   * size to make copying easier.
+  /* Copy the image to the RAM disk in large chunks. Nothing is in the cache
+   * yet, so the memory of all its buffers can hold a chunk on its way. The
+   * data goes from one device to the other with one request each way per
+   * chunk, instead of block by block through the cache. A driver may do
+   * less than asked at a time; then the chunk is as large as it did.
+   * A compressed image, recognized by its header, is decompressed on the way.
    */
-  if (block_size_image % block_size_ram) {
-  	printf("\nram block size: %d image block size: %d\n", 
-  		block_size_ram, block_size_image);
-  	panic(__FILE__, "ram disk block size must be a multiple of "
-  		"the image disk block size", NO_NUM);
-  }
+  printf("Loading RAM disk onto /dev/ram:\33[23CLoaded:    0 KB");
 
-  /* Loading blocks from image device. */
-  for (b = 0; b < (block_t) lcount; b++) {
-  	int rb, factor;
-	bp = rahead(&inode[0], b, (off_t)block_size_image * b, block_size_image);
-	factor = block_size_image/block_size_ram;
-  	for(rb = 0; rb < factor; rb++) {
-		bp1 = get_block(root_dev, b * factor + rb, NO_READ);
-		memcpy(bp1->b_data, bp->b_data + rb * block_size_ram,
-			(size_t) block_size_ram);
-		bp1->b_dirt = DIRTY;
-		put_block(bp1, FULL_DATA_BLOCK);
+  if (dev_io(DEV_READ, image_dev, FS_PROC_NR, sbbuf, 0L, MIN_BLOCK_SIZE, 0)
+				== MIN_BLOCK_SIZE && rz_check(sbbuf)) {
+	rz_load(image_dev, root_dev, sbbuf);
+  } else {
+	total = (off_t) lcount * sp->s_block_size;
+	for (pos = 0; pos < total; pos += r) {
+		chunk = sizeof(buf_space);
+		if (chunk > total - pos) chunk = (int) (total - pos);
+		r = dev_io(DEV_READ, image_dev, FS_PROC_NR,
+				(char *) buf_space, pos, chunk, 0);
+		if (r <= 0) panic(__FILE__,"Cannot read RAM disk image", r);
+		if (dev_io(DEV_WRITE, root_dev, FS_PROC_NR,
+				(char *) buf_space, pos, r, 0) != r)
+			panic(__FILE__,"Cannot write RAM disk", NO_NUM);
+		printf("\b\b\b\b\b\b\b\b\b%6ld KB",
+						(long) (pos + r) / 1024L);
 	}
-	put_block(bp, FULL_DATA_BLOCK);
-	if (b % 11 == 0)
-	printf("\b\b\b\b\b\b\b\b\b%6ld KB", ((long) b * block_size_image)/1024L);
   }
 
-  /* Commit changes to RAM so dev_io will see it. */
-  do_sync();
-
   printf("\rRAM disk of %u KB loaded onto /dev/ram.", (unsigned) ram_size_kb);
   if (root_dev == DEV_RAM) printf(" Using RAM disk as root FS.");
   printf("  \n");
@@ -440,6 +449,8 @@ PRIVATE void load_super(dev_t super_dev)
   /* Check super_block for consistency. */
   bad = (read_super(sp) != OK);
   if (!bad) {
+	journal_replay(sp);			/* undo a crash */
+	count_free(sp);
 	rip = get_inode(super_dev, ROOT_INODE);	/* inode for root dir */
 	if ( (rip->i_mode & I_TYPE) != I_DIRECTORY || rip->i_nlinks < 3) bad++;
   }
@@ -449,5 +460,7 @@ PRIVATE void load_super(dev_t super_dev)
   dup_inode(rip);
   sp->s_isup = rip;
   sp->s_rd_only = 0;
+  sp->s_discard = discard_probe(super_dev);
+  sp->s_direct = direct_dev(super_dev);
   return;
 }
@@ -169,19 +169,24 @@ PUBLIC int do_sync()
 /* Perform the sync() system call.  Flush all the tables. 
  * The order in which the various tables are flushed is critical.  The
  * blocks must be flushed last, since rw_inode() leaves its results in
- * the block cache.
+ * the block cache. With everything on the disk, journals can be emptied.
  */
-  register struct inode *rip;
   register struct buf *bp;
+  register struct super_block *sp;
+
+  /* Update runs sync() every 30 seconds; it keeps fs_time recent. */
+  (void) clock_time();
 
   /* Write all the dirty inodes to the disk. */
-  for (rip = &inode[0]; rip < &inode[NR_INODES]; rip++)
-	if (rip->i_count > 0 && rip->i_dirt == DIRTY) rw_inode(rip, WRITING);
+  flush_inodes(TRUE);
 
   /* Write all the dirty blocks to the disk, one drive at a time. */
-  for (bp = &buf[0]; bp < &buf[NR_BUFS]; bp++)
+  for (bp = &buf[0]; bp < &buf[NR_ALL_BUFS]; bp++)
 	if (bp->b_dev != NO_DEV && bp->b_dirt == DIRTY) flushall(bp->b_dev);
 
+  for (sp = &super_block[0]; sp < &super_block[NR_SUPERS]; sp++)
+	if (sp->s_dev != NO_DEV) journal_checkpoint(sp);
+
   return(OK);		/* sync() can't fail */
 }
 
@@ -190,9 +195,23 @@ PUBLIC int do_sync()
  *===========================================================================*/
 PUBLIC int do_fsync()
 {
-/* Perform the fsync() system call. For now, don't be unnecessarily smart. */
+/* Perform the fsync() system call. Only the file itself is written: its
+ * inode, the data, directory, and indirect blocks dirtied for it, and the
+ * dirty map blocks of its device, in one sorted batch. For a block special
+ * file the whole device is flushed.
+ */
+  register struct filp *rfilp;
+  register struct inode *rip;
+
+  if ( (rfilp = get_filp(m_in.fd)) == NIL_FILP) return(err_code);
+  rip = rfilp->filp_ino;
+
+  /* Update the inode in its block first; rw_inode() leaves it in the cache. */
+  if (rip->i_dirt == DIRTY || rip->i_lazy) rw_inode(rip, WRITING);
+  flushfile(rip);
 
-  do_sync();
+  if ((rip->i_mode & I_TYPE) == I_BLOCK_SPECIAL)
+	flushall((dev_t) rip->i_zone[0]);
 
   return(OK);
 }
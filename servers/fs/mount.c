@@ -9,6 +9,7 @@
 #include <fcntl.h>
 #include <minix/com.h>
 #include <sys/stat.h>
+#include <sys/mount.h>
 #include "buf.h"
 #include "file.h"
 #include "fproc.h"
@@ -23,14 +24,14 @@ FORWARD _PROTOTYPE( dev_t name_to_dev, (char *path)			);
  *===========================================================================*/
 PUBLIC int do_mount()
 {
-/* Perform the mount(name, mfile, rd_only) system call. */
+/* Perform the mount(name, mfile, flags) system call. */
 
   register struct inode *rip, *root_ip;
   struct super_block *xp, *sp;
   dev_t dev;
   mode_t bits;
   int rdir, mdir;		/* TRUE iff {root|mount} file is dir */
-  int r, found;
+  int r, found, rd_only;
 
   /* Only the super-user may do MOUNT. */
   if (!super_user) return(EPERM);
@@ -47,10 +48,21 @@ PUBLIC int do_mount()
     if (xp->s_dev == NO_DEV) sp = xp;	/* record free slot */
   }
   if (found) return(EBUSY);	/* already mounted */
+
+  /* Take a snapshot of the file system 'mfile' is on, kept on 'name'. */
+  if (m_in.mnt_flags & MS_SNAPSHOT) {
+	if (fetch_name(m_in.name2, m_in.name2_length, M1) != OK)
+		return(err_code);
+	if ( (rip = eat_path(user_path)) == NIL_INODE) return(err_code);
+	r = snap_create(dev, rip->i_sp);
+	put_inode(rip);
+	return(r);
+  }
   if (sp == NIL_SUPER) return(ENFILE);	/* no super block available */
 
-  /* Open the device the file system lives on. */
-  if (dev_open(dev, who, m_in.rd_only ? R_BIT : (R_BIT|W_BIT)) != OK) 
+  /* Open the device the file system lives on. A snapshot is read-only. */
+  rd_only = (m_in.mnt_flags & MS_RDONLY) != 0 || snap_view(dev);
+  if (dev_open(dev, who, rd_only ? R_BIT : (R_BIT|W_BIT)) != OK) 
   	return(EINVAL);
 
   /* Make the cache forget about blocks it has open on the filesystem */
@@ -68,6 +80,14 @@ PUBLIC int do_mount()
     return(r);
   }
 
+  /* Bring the metadata up to the last journal commit. A snapshot was taken
+   * right after a sync, so its journal has nothing to replay.
+   */
+  if (snap_view(dev)) sp->s_jblocks = 0;
+  sp->s_rd_only = rd_only;	/* a read-only journal is not replayed */
+  journal_replay(sp);
+  count_free(sp);
+
   /* Now get the inode of the file to be mounted on. */
   if (fetch_name(m_in.name2, m_in.name2_length, M1) != OK) {
     dev_close(dev);
@@ -119,7 +139,14 @@ PUBLIC int do_mount()
   rip->i_mount = I_MOUNT;	/* this bit says the inode is mounted on */
   sp->s_imount = rip;
   sp->s_isup = root_ip;
-  sp->s_rd_only = m_in.rd_only;
+  sp->s_rd_only = rd_only;
+  sp->s_discard = !rd_only && discard_probe(dev);
+  sp->s_direct = direct_dev(dev);
+  sp->s_flags = m_in.mnt_flags &
+	(MS_NOATIME | MS_RELATIME | MS_LAZYTIME | MS_INLINE);
+
+  /* Give the file system a journal if asked to. This is no reason to fail. */
+  if ((m_in.mnt_flags & MS_JOURNAL) && !rd_only) (void) journal_create(sp);
   return(OK);
 }
 
@@ -129,6 +156,7 @@ PUBLIC int do_mount()
 PUBLIC int do_umount()
 {
 /* Perform the umount(name) system call. */
+  struct super_block *sp;
   dev_t dev;
 
   /* Only the super-user may do UMOUNT. */
@@ -138,6 +166,12 @@ PUBLIC int do_umount()
   if (fetch_name(m_in.name, m_in.name_length, M3) != OK) return(err_code);
   if ( (dev = name_to_dev(user_path)) == NO_DEV) return(err_code);
 
+  /* The store of a snapshot that is not mounted: end the snapshot. */
+  if (snap_view(dev)) {
+	for (sp = &super_block[0]; sp < &super_block[NR_SUPERS]; sp++)
+		if (sp->s_dev == dev) break;
+	if (sp == &super_block[NR_SUPERS]) return(snap_end(dev));
+  }
   return(unmount(dev));
 }
 
@@ -151,6 +185,9 @@ PUBLIC int unmount(Dev_t dev)
   struct super_block *sp, *sp1;
   int count;
 
+  /* A file system that a snapshot is kept of must stay. */
+  if (snap_busy(dev)) return(EBUSY);
+
   /* See if the mounted device is busy.  Only 1 inode using it should be
    * open -- the root inode -- and that inode only 1 time.
    */
@@ -171,6 +208,7 @@ PUBLIC int unmount(Dev_t dev)
   /* Sync the disk, and invalidate cache. */
   (void) do_sync();		/* force any cached blocks out of memory */
   invalidate(dev);		/* invalidate cache entries for this dev */
+  dirhash_drop(dev, (ino_t) 0);	/* and directory indexes */
   if (sp == NIL_SUPER) {
   	return(EINVAL);
   }
@@ -6,6 +6,8 @@
  *   last_dir:	 find the final directory on a given path
  *   advance:	 parse one component of a path name
  *   search_dir: search a directory for a string and return its inode number
+ *
+ * Large directories are searched through an index in memory, see dirhash.c.
  */
 
 #include "fs.h"
@@ -21,6 +23,8 @@ PUBLIC char dot1[2] = ".";	/* used for search_dir to bypass the access */
 PUBLIC char dot2[3] = "..";	/* permissions for . and ..		    */
 
 FORWARD _PROTOTYPE( char *get_name, (char *old_name, char string [NAME_MAX]) );
+FORWARD _PROTOTYPE( int dir_found, (struct inode *ldir_ptr, struct buf *bp,
+			struct direct *dp, ino_t *numb, int flag)	);
 
 /*===========================================================================*
  *				eat_path				     *
@@ -249,11 +253,11 @@ PUBLIC int search_dir(register struct inode *ldir_ptr, char string[NAME_MAX], in
  */
 
   register struct direct *dp = NULL;
-  register struct buf *bp = NULL;
-  int i, r, e_hit, t, match;
+  struct buf *bp = NULL;
+  int i, r, e_hit, match, indexed;
   mode_t bits;
   off_t pos;
-  unsigned new_slots, old_slots;
+  unsigned new_slots, old_slots, slot, epb;
   block_t b;
   struct super_block *sp;
   int extended = 0;
@@ -273,14 +277,27 @@ PUBLIC int search_dir(register struct inode *ldir_ptr, char string[NAME_MAX], in
 	else r = forbidden(ldir_ptr, bits); /* check access permissions */
   }
   if (r != OK) return(r);
+
+  /* A large directory has an index in memory. LOOK_UP and DELETE go straight
+   * to the name through it; ENTER uses it to skip slots known to be in use.
+   */
+  epb = NR_DIR_ENTRIES(ldir_ptr->i_sp->s_block_size);
+  indexed = (flag != IS_EMPTY && dirhash_get(ldir_ptr));
+  if (indexed && flag != ENTER) {
+	if ((r = dirhash_find(ldir_ptr, string, &bp, &slot)) != OK) return(r);
+	if (flag == DELETE) dirhash_delete(ldir_ptr, string, slot);
+	return(dir_found(ldir_ptr, bp, &bp->b_dir[slot % epb], numb, flag));
+  }
   
   /* Step through the directory one block at a time. */
   old_slots = (unsigned) (ldir_ptr->i_size/DIR_ENTRY_SIZE);
   new_slots = 0;
+  if (indexed) new_slots = dirhash_hint(ldir_ptr) / epb * epb;
   e_hit = FALSE;
   match = 0;			/* set when a string match occurs */
 
-  for (pos = 0; pos < ldir_ptr->i_size; pos += ldir_ptr->i_sp->s_block_size) {
+  for (pos = (off_t) new_slots * DIR_ENTRY_SIZE; pos < ldir_ptr->i_size;
+  				pos += ldir_ptr->i_sp->s_block_size) {
 	b = read_map(ldir_ptr, pos);	/* get block number */
 
 	/* Since directories don't have holes, 'b' cannot be NO_BLOCK. */
@@ -291,7 +308,7 @@ PUBLIC int search_dir(register struct inode *ldir_ptr, char string[NAME_MAX], in
 
 	/* Search a directory block. */
 	for (dp = &bp->b_dir[0];
-		dp < &bp->b_dir[NR_DIR_ENTRIES(ldir_ptr->i_sp->s_block_size)];
+		dp < &bp->b_dir[epb];
 		dp++) {
 		if (++new_slots > old_slots) { /* not found, but room left */
 			if (flag == ENTER) e_hit = TRUE;
@@ -313,22 +330,7 @@ PUBLIC int search_dir(register struct inode *ldir_ptr, char string[NAME_MAX], in
 
 		if (match) {
 			/* LOOK_UP or DELETE found what it wanted. */
-			r = OK;
-			if (flag == IS_EMPTY) r = ENOTEMPTY;
-			else if (flag == DELETE) {
-				/* Save d_ino for recovery. */
-				t = NAME_MAX - sizeof(ino_t);
-				*((ino_t *) &dp->d_name[t]) = dp->d_ino;
-				dp->d_ino = 0;	/* erase entry */
-				bp->b_dirt = DIRTY;
-				ldir_ptr->i_update |= CTIME | MTIME;
-				ldir_ptr->i_dirt = DIRTY;
-			} else {
-				sp = ldir_ptr->i_sp;	/* 'flag' is LOOK_UP */
-				*numb = conv4(sp->s_native, (int) dp->d_ino);
-			}
-			put_block(bp, DIRECTORY_BLOCK);
-			return(r);
+			return(dir_found(ldir_ptr, bp, dp, numb, flag));
 		}
 
 		/* Check for free slot for the benefit of ENTER. */
@@ -366,6 +368,7 @@ PUBLIC int search_dir(register struct inode *ldir_ptr, char string[NAME_MAX], in
   sp = ldir_ptr->i_sp; 
   dp->d_ino = conv4(sp->s_native, (int) *numb);
   bp->b_dirt = DIRTY;
+  bp->b_ino = ldir_ptr->i_num;
   put_block(bp, DIRECTORY_BLOCK);
   ldir_ptr->i_update |= CTIME | MTIME;	/* mark mtime for update later */
   ldir_ptr->i_dirt = DIRTY;
@@ -374,5 +377,42 @@ PUBLIC int search_dir(register struct inode *ldir_ptr, char string[NAME_MAX], in
 	/* Send the change to disk if the directory is extended. */
 	if (extended) rw_inode(ldir_ptr, WRITING);
   }
+  if (indexed) dirhash_enter(ldir_ptr, string, new_slots - 1);
   return(OK);
 }
+
+/*===========================================================================*
+ *				dir_found				     *
+ *===========================================================================*/
+/* directory searched */
+/* block holding the entry */
+/* the entry that matched */
+/* for LOOK_UP, the inode number goes here */
+/* LOOK_UP, DELETE, or IS_EMPTY */
+PRIVATE int dir_found(struct inode *ldir_ptr, struct buf *bp,
+			struct direct *dp, ino_t *numb, int flag)
+{
+/* Search_dir() found a matching entry. Do what 'flag' asks, put the block,
+ * and return the result of the search.
+ */
+  struct super_block *sp;
+  int r, t;
+
+  r = OK;
+  if (flag == IS_EMPTY) r = ENOTEMPTY;
+  else if (flag == DELETE) {
+	/* Save d_ino for recovery. */
+	t = NAME_MAX - sizeof(ino_t);
+	*((ino_t *) &dp->d_name[t]) = dp->d_ino;
+	dp->d_ino = 0;	/* erase entry */
+	bp->b_dirt = DIRTY;
+	bp->b_ino = ldir_ptr->i_num;
+	ldir_ptr->i_update |= CTIME | MTIME;
+	ldir_ptr->i_dirt = DIRTY;
+  } else {
+	sp = ldir_ptr->i_sp;	/* 'flag' is LOOK_UP */
+	*numb = conv4(sp->s_native, (int) dp->d_ino);
+  }
+  put_block(bp, DIRECTORY_BLOCK);
+  return(r);
+}
@@ -10,9 +10,14 @@ struct super_block;
 
 /* cache.c */
 _PROTOTYPE( zone_t alloc_zone, (Dev_t dev, zone_t z)			);
+_PROTOTYPE( void discard_flush, (void)					);
+_PROTOTYPE( int direct_dev, (Dev_t dev)				);
+_PROTOTYPE( int discard_probe, (Dev_t dev)				);
 _PROTOTYPE( void flushall, (Dev_t dev)					);
+_PROTOTYPE( void flushfile, (struct inode *rip)			);
 _PROTOTYPE( void free_zone, (Dev_t dev, zone_t numb)			);
 _PROTOTYPE( struct buf *get_block, (Dev_t dev, block_t block,int only_search));
+_PROTOTYPE( int in_cache, (Dev_t dev, block_t block)			);
 _PROTOTYPE( void invalidate, (Dev_t device)				);
 _PROTOTYPE( void put_block, (struct buf *bp, int block_type)		);
 _PROTOTYPE( void rw_block, (struct buf *bp, int rw_flag)		);
@@ -38,6 +43,17 @@ _PROTOTYPE( void dev_status, (message *)				);
 /* dmp.c */
 _PROTOTYPE( int do_fkey_pressed, (void)					);
 
+/* dirhash.c */
+_PROTOTYPE( int dirhash_get, (struct inode *dirp)			);
+_PROTOTYPE( int dirhash_find, (struct inode *dirp, char string[NAME_MAX],
+				struct buf **bpp, unsigned *slotp)	);
+_PROTOTYPE( unsigned dirhash_hint, (struct inode *dirp)			);
+_PROTOTYPE( void dirhash_enter, (struct inode *dirp, char string[NAME_MAX],
+				unsigned slot)				);
+_PROTOTYPE( void dirhash_delete, (struct inode *dirp, char string[NAME_MAX],
+				unsigned slot)				);
+_PROTOTYPE( void dirhash_drop, (Dev_t dev, Ino_t ino)			);
+
 /* dmap.c */
 _PROTOTYPE( int do_devctl, (void)					);
 _PROTOTYPE( void build_dmap, (void)					);
@@ -56,8 +72,22 @@ _PROTOTYPE( struct inode *get_inode, (Dev_t dev, int numb)		);
 _PROTOTYPE( void put_inode, (struct inode *rip)				);
 _PROTOTYPE( void update_times, (struct inode *rip)			);
 _PROTOTYPE( void rw_inode, (struct inode *rip, int rw_flag)		);
+_PROTOTYPE( block_t inode_blocknr, (struct inode *rip)			);
+_PROTOTYPE( void flush_inodes, (int lazy)				);
+_PROTOTYPE( void mark_atime, (struct inode *rip)			);
+_PROTOTYPE( void prefetch_inodes, (struct inode *dirp, struct buf *dbp)	);
 _PROTOTYPE( void wipe_inode, (struct inode *rip)			);
 
+/* journal.c */
+_PROTOTYPE( void journal_add, (struct buf *bp, int block_type)		);
+_PROTOTYPE( void journal_check, (void)					);
+_PROTOTYPE( void journal_checkpoint, (struct super_block *sp)		);
+_PROTOTYPE( void journal_commit, (Dev_t dev)				);
+_PROTOTYPE( int journal_create, (struct super_block *sp)		);
+_PROTOTYPE( void journal_replay, (struct super_block *sp)		);
+_PROTOTYPE( void journal_revoke, (struct super_block *sp, zone_t zone)	);
+_PROTOTYPE( void journal_write, (Dev_t dev, block_t block, int count)	);
+
 /* link.c */
 _PROTOTYPE( int do_link, (void)						);
 _PROTOTYPE( int do_unlink, (void)					);
@@ -135,6 +165,18 @@ _PROTOTYPE( block_t read_map, (struct inode *rip, off_t position)	);
 _PROTOTYPE( int read_write, (int rw_flag)				);
 _PROTOTYPE( zone_t rd_indir, (struct buf *bp, int index)		);
 
+/* ramzip.c */
+_PROTOTYPE( int rz_check, (char *hdr)					);
+_PROTOTYPE( void rz_load, (Dev_t image_dev, Dev_t ram_dev, char *hdr)	);
+
+/* snap.c */
+_PROTOTYPE( int snap_busy, (Dev_t dev)					);
+_PROTOTYPE( void snap_copy, (Dev_t dev, off_t pos, unsigned bytes)	);
+_PROTOTYPE( int snap_create, (Dev_t store, struct super_block *sp)	);
+_PROTOTYPE( dev_t snap_dev, (Dev_t dev, off_t pos)			);
+_PROTOTYPE( int snap_end, (Dev_t store)					);
+_PROTOTYPE( int snap_view, (Dev_t dev)					);
+
 /* stadir.c */
 _PROTOTYPE( int do_chdir, (void)					);
 _PROTOTYPE( int do_fchdir, (void)					);
@@ -145,6 +187,7 @@ _PROTOTYPE( int do_fstatfs, (void)					);
 
 /* super.c */
 _PROTOTYPE( bit_t alloc_bit, (struct super_block *sp, int map, bit_t origin));
+_PROTOTYPE( void count_free, (struct super_block *sp)			);
 _PROTOTYPE( void free_bit, (struct super_block *sp, int map,
 						bit_t bit_returned)	);
 _PROTOTYPE( struct super_block *get_super, (Dev_t dev)			);
@@ -165,10 +208,12 @@ _PROTOTYPE( int no_sys, (void)						);
 _PROTOTYPE( void panic, (char *who, char *mess, int num)		);
 
 /* write.c */
+_PROTOTYPE( block_t alloc_block, (struct inode *rip, off_t position)	);
 _PROTOTYPE( void clear_zone, (struct inode *rip, off_t pos, int flag)	);
 _PROTOTYPE( int do_write, (void)					);
 _PROTOTYPE( struct buf *new_block, (struct inode *rip, off_t position)	);
 _PROTOTYPE( void zero_block, (struct buf *bp)				);
+_PROTOTYPE( int uninline, (struct inode *rip)				);
 
 /* select.c */
 _PROTOTYPE( int do_select, (void)					);
@@ -0,0 +1,198 @@
+/* This file loads a compressed RAM disk image, see <minix/ramzip.h>. The
+ * image is read in large chunks, its frames are decoded, and the result is
+ * written to the RAM disk in large chunks too. Like the plain load in
+ * main.c, this happens before anything is cached, so the memory of the
+ * buffer cache is used: the first half holds compressed data read, the
+ * second half decoded data to be written.
+ *
+ * The entry points into this file are
+ *   rz_check:	tell if the start of an image device is that of a compressed one
+ *   rz_load:	decompress an image onto the RAM disk
+ */
+
+#include "fs.h"
+#include <string.h>
+#include <minix/com.h>
+#include <minix/ramzip.h>
+#include "buf.h"
+
+PRIVATE Dev_t rz_dev;		/* the image device */
+PRIVATE off_t rz_pos;		/* where to read it next */
+PRIVATE unsigned char *rz_in;	/* compressed data */
+PRIVATE unsigned rz_insize;	/* size of the buffer for it */
+PRIVATE unsigned rz_have;	/* bytes in the buffer */
+PRIVATE unsigned rz_next;	/* the first of them not used yet */
+
+FORWARD _PROTOTYPE( void rz_fill, (unsigned need)			);
+FORWARD _PROTOTYPE( int unlz4, (unsigned char *src, unsigned slen,
+				unsigned char *dst, unsigned dlen)	);
+FORWARD _PROTOTYPE( u32_t get32, (unsigned char *p)			);
+
+/*===========================================================================*
+ *				rz_check				     *
+ *===========================================================================*/
+/* the first bytes of the image device */
+PUBLIC int rz_check(char *hdr)
+{
+  return(memcmp(hdr, RZ_MAGIC, RZ_MAGIC_LEN) == 0);
+}
+
+/*===========================================================================*
+ *				rz_load					     *
+ *===========================================================================*/
+/* device with the compressed image */
+/* the RAM disk */
+/* the first bytes of the image device */
+PUBLIC void rz_load(Dev_t image_dev, Dev_t ram_dev, char *hdr)
+{
+/* Decompress an image onto the RAM disk, showing the progress. */
+  unsigned char *out;
+  unsigned out_size, olen, flen;
+  u32_t frame, clen;
+  off_t total, done;
+  int r;
+
+  total = (off_t) get32((unsigned char *) hdr + RZ_SIZE_OFF);
+  frame = get32((unsigned char *) hdr + RZ_FRAME_OFF);
+
+  rz_dev = image_dev;
+  rz_pos = RZ_HDR_SIZE;
+  rz_in = (unsigned char *) buf_space;
+  rz_insize = (sizeof(buf_space) / 2) & ~(RZ_ALIGN - 1);
+  rz_have = rz_next = 0;
+  out = rz_in + rz_insize;
+  out_size = sizeof(buf_space) - rz_insize;
+  if (frame == 0 || frame > RZ_FRAME_MAX || frame > out_size)
+	panic(__FILE__,"Bad frame size in RAM disk image", (int) frame);
+
+  done = 0;
+  olen = 0;
+  while (done < total) {
+	/* Get the next frame. */
+	rz_fill(4);
+	clen = get32(rz_in + rz_next);
+	rz_next += 4;
+	if ((clen & ~RZ_STORED) > RZ_CFRAME_MAX)
+		panic(__FILE__,"Bad frame in RAM disk image", NO_NUM);
+	rz_fill((unsigned) (clen & ~RZ_STORED));
+
+	/* Decode it behind what is waiting to be written. */
+	flen = frame;
+	if (total - done - olen < flen) flen = (unsigned) (total - done - olen);
+	if (clen & RZ_STORED) {
+		clen &= ~RZ_STORED;
+		if (clen != flen)
+			panic(__FILE__,"Bad frame in RAM disk image", NO_NUM);
+		memcpy(out + olen, rz_in + rz_next, flen);
+	} else {
+		if (unlz4(rz_in + rz_next, (unsigned) clen, out + olen, flen)
+								!= flen)
+			panic(__FILE__,"Bad frame in RAM disk image", NO_NUM);
+	}
+	rz_next += (unsigned) clen;
+	olen += flen;
+
+	/* Write when another frame may not fit, or at the end. */
+	if (olen + frame > out_size || done + olen == total) {
+		r = dev_io(DEV_WRITE, ram_dev, FS_PROC_NR, (char *) out,
+							done, olen, 0);
+		if (r != olen) panic(__FILE__,"Cannot write RAM disk", r);
+		done += olen;
+		olen = 0;
+		printf("\b\b\b\b\b\b\b\b\b%6ld KB", (long) done / 1024L);
+	}
+  }
+}
+
+/*===========================================================================*
+ *				rz_fill					     *
+ *===========================================================================*/
+/* bytes wanted in the input buffer */
+PRIVATE void rz_fill(unsigned need)
+{
+/* Make sure that the next 'need' bytes of the image are in the input buffer.
+ * What is left is moved to the front, and as much is read as fits.
+ */
+  unsigned left;
+  int r;
+
+  while (rz_have - rz_next < need) {
+	left = rz_have - rz_next;
+	memmove(rz_in, rz_in + rz_next, left);
+	rz_have = left;
+	rz_next = 0;
+	r = dev_io(DEV_READ, rz_dev, FS_PROC_NR, (char *) rz_in + rz_have,
+		rz_pos, (rz_insize - rz_have) & ~(RZ_ALIGN - 1), 0);
+	if (r <= 0) panic(__FILE__,"RAM disk image is cut short", r);
+	rz_pos += r;
+	rz_have += r;
+  }
+}
+
+/*===========================================================================*
+ *				unlz4					     *
+ *===========================================================================*/
+/* LZ4 block */
+/* its size */
+/* where to decode it */
+/* room there */
+PRIVATE int unlz4(unsigned char *src, unsigned slen, unsigned char *dst,
+							unsigned dlen)
+{
+/* Decode an LZ4 block: a series of sequences, each some literal bytes and a
+ * copy of earlier output; the last one has only literals. Return the number
+ * of bytes decoded, or -1 if the block is bad.
+ */
+  unsigned char *s, *send, *d, *dend, *m;
+  unsigned len, off, c;
+  int token;
+
+  s = src;
+  send = src + slen;
+  d = dst;
+  dend = dst + dlen;
+  while (s < send) {
+	token = *s++;
+
+	/* Literals. */
+	if ((len = token >> 4) == 15) {
+		do {
+			if (s == send) return(-1);
+			len += (c = *s++);
+		} while (c == 255);
+	}
+	if (len > (unsigned) (send - s) || len > (unsigned) (dend - d))
+		return(-1);
+	memcpy(d, s, len);
+	d += len;
+	s += len;
+	if (s == send) break;
+
+	/* Match. It may overlap its own output, so copy byte by byte. */
+	if (send - s < 2) return(-1);
+	off = s[0] | (s[1] << 8);
+	s += 2;
+	if (off == 0 || off > (unsigned) (d - dst)) return(-1);
+	if ((len = token & 0x0F) == 15) {
+		do {
+			if (s == send) return(-1);
+			len += (c = *s++);
+		} while (c == 255);
+	}
+	len += 4;
+	if (len > (unsigned) (dend - d)) return(-1);
+	m = d - off;
+	while (len-- > 0) *d++ = *m++;
+  }
+  return(d - dst);
+}
+
+/*===========================================================================*
+ *				get32					     *
+ *===========================================================================*/
+/* four bytes, little endian */
+PRIVATE u32_t get32(unsigned char *p)
+{
+  return((u32_t) p[0] | ((u32_t) p[1] << 8) | ((u32_t) p[2] << 16)
+						| ((u32_t) p[3] << 24));
+}
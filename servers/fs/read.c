@@ -7,6 +7,7 @@
  *   do_read:	 perform the READ system call by calling read_write
  *   read_write: actually do the work of READ and WRITE
  *   read_map:	 given an inode and file position, look up its zone number
+ *		 (there is none for an inline file)
  *   rd_indir:	 read an entry in an indirect block 
  *   read_ahead: manage the block read ahead business
  */
@@ -20,10 +21,12 @@
 #include "inode.h"
 #include "param.h"
 #include "super.h"
+#include <sys/mount.h>
 
 FORWARD _PROTOTYPE( int rw_chunk, (struct inode *rip, off_t position,
 	unsigned off, int chunk, unsigned left, int rw_flag,
 	char *buff, int seg, int usr, int block_size, int *completed));
+FORWARD _PROTOTYPE( int may_inline, (struct inode *rip)			);
 
 /*===========================================================================*
  *				do_read					     *
@@ -209,9 +212,13 @@ PUBLIC int read_write(int rw_flag)
   }
   f->filp_pos = position;
 
-  /* Check to see if read-ahead is called for, and if so, set it up. */
+  /* Check to see if read-ahead is called for, and if so, set it up. Data that
+   * rw_chunk() copies straight from the device is not read ahead; it would
+   * only end up in the cache and be copied from there.
+   */
   if (rw_flag == READING && rip->i_seek == NO_SEEK && position % block_size== 0
-		&& (regular || mode_word == I_DIRECTORY)) {
+		&& (regular || mode_word == I_DIRECTORY)
+		&& !(regular && seg == D && rip->i_sp->s_direct)) {
 	rdahed_inode = rip;
 	rdahedpos = position;
   }
@@ -225,9 +232,11 @@ PUBLIC int read_write(int rw_flag)
 	r = r2;
   }
   if (r == OK) {
-    if (rw_flag == READING) rip->i_update |= ATIME;
-    if (rw_flag == WRITING) rip->i_update |= CTIME | MTIME;
-    rip->i_dirt = DIRTY;		/* inode is thus now dirty */
+    if (rw_flag == READING) mark_atime(rip);
+    if (rw_flag == WRITING) {
+	rip->i_update |= CTIME | MTIME;
+	rip->i_dirt = DIRTY;		/* inode is thus now dirty */
+    }
     if (partial_pipe) {
       partial_pipe = 0;
         /* partial write on pipe with */
@@ -271,9 +280,32 @@ PRIVATE int rw_chunk(register struct inode *rip, off_t position, unsigned off, i
   int n, block_spec;
   block_t b;
   dev_t dev;
+  off_t pos;
 
   *completed = 0;
 
+  /* A small file may have its data in the inode. It stays there while it
+   * fits; a write that does not fit moves the data to a block first.
+   */
+  if (rw_flag == WRITING && !rip->i_inline && position + chunk <= INLINE_MAX)
+	rip->i_inline = may_inline(rip);
+  if (rip->i_inline) {
+	if (rw_flag == READING || position + chunk <= INLINE_MAX) {
+		if (rw_flag == READING) {
+			r = sys_vircopy(FS_PROC_NR, D,
+				(phys_bytes) ((char *) rip->i_zone + position),
+				usr, seg, (phys_bytes) buff, (phys_bytes) chunk);
+		} else {
+			r = sys_vircopy(usr, seg, (phys_bytes) buff, FS_PROC_NR,
+				D, (phys_bytes) ((char *) rip->i_zone + position),
+				(phys_bytes) chunk);
+			rip->i_dirt = DIRTY;
+		}
+		return(r);
+	}
+	if ((r = uninline(rip)) != OK) return(r);
+  }
+
   block_spec = (rip->i_mode & I_TYPE) == I_BLOCK_SPECIAL;
   if (block_spec) {
     b = position/block_size;
@@ -283,10 +315,35 @@ PRIVATE int rw_chunk(register struct inode *rip, off_t position, unsigned off, i
     dev = rip->i_dev;
   }
 
+  /* The data of a file on a RAM disk is copied straight between the user and
+   * the disk, once, unless the block is in the cache already or has to be
+   * zeroed first. No buffers are taken from the cache for it.
+   */
+  if (!block_spec && rip->i_sp->s_direct && seg == D &&
+				(rip->i_mode & I_TYPE) == I_REGULAR) {
+	if (rw_flag == WRITING && b == NO_BLOCK && chunk == block_size) {
+		if ((b = alloc_block(rip, position)) == NO_BLOCK)
+			return(err_code);
+	}
+	if (b != NO_BLOCK && !in_cache(dev, b) && (rw_flag == READING ||
+		chunk == block_size || off != 0 || position < rip->i_size)) {
+		pos = (off_t) b * block_size + off;
+		if (rw_flag == WRITING) {
+			journal_write(dev, b, 1);
+			snap_copy(dev, pos, (unsigned) chunk);
+		}
+		r = dev_io(rw_flag == READING ? DEV_READ : DEV_WRITE, dev, usr,
+							buff, pos, chunk, 0);
+		return(r == chunk ? OK : (r < 0 ? r : EIO));
+	}
+  }
+
   if (!block_spec && b == NO_BLOCK) {
     if (rw_flag == READING) {
-      /* Reading from a nonexistent block.  Must read as all zeros.*/
-      bp = get_block(NO_DEV, NO_BLOCK, NORMAL);    /* get a buffer */
+      /* Reading from a nonexistent block.  Must read as all zeros. An
+       * unnamed buffer large enough for the blocks of 'dev' will do.
+       */
+      bp = get_block(dev, NO_BLOCK, UNNAMED);     /* get a buffer */
       zero_block(bp);
     } else {
       /* Writing to a nonexistent block. Create and enter in inode.*/
@@ -315,6 +372,13 @@ PRIVATE int rw_chunk(register struct inode *rip, off_t position, unsigned off, i
   }
 
   if (rw_flag == READING) {
+    /* Reading a directory from the start of a block? Then the inodes of its
+     * entries will probably be wanted soon.
+     */
+    if (off == 0 && (rip->i_mode & I_TYPE) == I_DIRECTORY &&
+							bp->b_dev != NO_DEV)
+	prefetch_inodes(rip, bp);
+
     /* Copy a chunk from the block buffer to user space. */
     r = sys_vircopy(FS_PROC_NR, D, (phys_bytes) (bp->b_data+off),
         usr, seg, (phys_bytes) buff,
@@ -325,6 +389,7 @@ PRIVATE int rw_chunk(register struct inode *rip, off_t position, unsigned off, i
         FS_PROC_NR, D, (phys_bytes) (bp->b_data+off),
         (phys_bytes) chunk);
     bp->b_dirt = DIRTY;
+    bp->b_ino = rip->i_num;
   }
   n = (off + chunk == block_size ? FULL_DATA_BLOCK : PARTIAL_DATA_BLOCK);
   put_block(bp, n);
@@ -333,6 +398,25 @@ PRIVATE int rw_chunk(register struct inode *rip, off_t position, unsigned off, i
 }
 
 
+/*===========================================================================*
+ *				may_inline				     *
+ *===========================================================================*/
+/* empty file about to be written */
+PRIVATE int may_inline(register struct inode *rip)
+{
+/* Tell if the data of a file may go in its inode: it must be an empty regular
+ * file without zones, on a V3 file system mounted with MS_INLINE.
+ */
+  int i;
+
+  if ((rip->i_mode & I_TYPE) != I_REGULAR || rip->i_size != 0) return(FALSE);
+  if (rip->i_sp->s_version != V3 || !(rip->i_sp->s_flags & MS_INLINE))
+	return(FALSE);
+  for (i = 0; i < V2_NR_TZONES; i++)
+	if (rip->i_zone[i] != NO_ZONE) return(FALSE);
+  return(TRUE);
+}
+
 /*===========================================================================*
  *				read_map				     *
  *===========================================================================*/
@@ -350,6 +434,8 @@ PUBLIC block_t read_map(register struct inode *rip, off_t position)
   block_t b;
   long excess, zone, block_pos;
   
+  if (rip->i_inline) return(NO_BLOCK);	/* data is in the inode */
+
   scale = rip->i_sp->s_log_zone_size;	/* for block-zone conversion */
   block_pos = position/rip->i_sp->s_block_size;	/* relative blk # in file */
   zone = block_pos >> scale;	/* position's zone */
@@ -472,7 +558,8 @@ PUBLIC struct buf *rahead(register struct inode *rip, block_t baseblock, off_t p
   off_t ind1_pos;
   dev_t dev;
   struct buf *bp;
-  static struct buf *read_q[NR_BUFS];
+  struct bufclass *bc;
+  static struct buf *read_q[NR_ALL_BUFS];
 
   block_spec = (rip->i_mode & I_TYPE) == I_BLOCK_SPECIAL;
   if (block_spec) {
@@ -547,7 +634,8 @@ PUBLIC struct buf *rahead(register struct inode *rip, block_t baseblock, off_t p
     if (--blocks_ahead == 0) break;
 
     /* Don't trash the cache, leave 4 free. */
-    if (bufs_in_use >= NR_BUFS - 4) break;
+    bc = BUF_CLASS(bp);
+    if (bc->bc_in_use >= bc->bc_count - 4) break;
 
     block++;
 
@@ -110,7 +110,8 @@ PRIVATE int select_request_general(struct filp *f, int *ops, int block)
 {
 	int rops = *ops;
 	if (block) rops |= SEL_NOTIFY;
-	*ops = dev_io(DEV_SELECT, f->filp_ino->i_zone[0], rops, NULL, 0, 0, 0);
+	/* The count tells the driver which process selects. */
+	*ops = dev_io(DEV_SELECT, f->filp_ino->i_zone[0], rops, NULL, 0, who, 0);
 	if (*ops < 0)
 		return SEL_ERR;
 	return SEL_OK;
@@ -0,0 +1,213 @@
+/* This file implements copy-on-write snapshots. A snapshot freezes a mounted
+ * file system as it is at one moment, while the file system stays in use.
+ * Before a block of the file system is overwritten for the first time after
+ * the snapshot was taken, its old contents are copied to the same place on a
+ * second device, the store. The store can then be mounted read-only, and shows
+ * the file system as it was: a block read from the store comes from the store
+ * if it was saved there, or else from the file system, where it has not
+ * changed since. A backup can thus read the snapshot at full speed, while the
+ * file system is written.
+ *
+ * Blocks of zones that were free when the snapshot was taken are not part of
+ * it and are never copied; neither are the blocks of the journal, which the
+ * snapshot does not use. A bit map tells which blocks need no copy (any more).
+ * There is one snapshot at a time, of at most SNAP_MAX_BLOCKS blocks.
+ *
+ *   mount(store, file, MS_SNAPSHOT)	snapshot the file system 'file' is on
+ *   mount(store, dir, MS_RDONLY)	mount the snapshot on 'dir'
+ *   umount(store)			unmount it, or if not mounted, end it
+ *
+ * The entry points into this file are
+ *   snap_create:	take a snapshot of a file system
+ *   snap_end:		end the snapshot kept on a store device
+ *   snap_copy:		save blocks of a file system about to be overwritten
+ *   snap_dev:		tell which device a block of a store is read from
+ *   snap_busy:		tell if a snapshot is kept of a device
+ *   snap_view:		tell if a device is the store of a snapshot
+ */
+
+#include "fs.h"
+#include <string.h>
+#include <minix/com.h>
+#include "buf.h"
+#include "inode.h"
+#include "super.h"
+
+#define SNAP_CHUNK(b)	snap_done[(b) / FS_BITCHUNK_BITS]
+#define SNAP_BIT(b)	(1 << (unsigned) ((b) % FS_BITCHUNK_BITS))
+#define SNAP_DONE(b)	((SNAP_CHUNK(b) & SNAP_BIT(b)) != 0)
+#define SNAP_SET(b)	(SNAP_CHUNK(b) |= SNAP_BIT(b))
+
+PRIVATE struct snapshot {
+  dev_t sn_dev;			/* file system of the snapshot, or NO_DEV */
+  dev_t sn_store;		/* where the old blocks are saved */
+  int sn_block_size;		/* block size of the file system */
+  block_t sn_blocks;		/* blocks in the file system */
+} snap;
+
+/* A bit for every block: set if it needs no copy. */
+PRIVATE bitchunk_t snap_done[SNAP_MAX_BLOCKS / FS_BITCHUNK_BITS];
+
+PRIVATE char snap_buf[MAX_MOUNT_BLOCK_SIZE];	/* blocks being copied */
+
+/*===========================================================================*
+ *				snap_create				     *
+ *===========================================================================*/
+/* device to keep the snapshot on */
+/* file system to take a snapshot of */
+PUBLIC int snap_create(Dev_t store, struct super_block *sp)
+{
+/* Take a snapshot of a mounted file system. */
+  struct buf *bp;
+  block_t blocks, b, mapblock;
+  zone_t z;
+  bit_t bit;
+  int bs, scale;
+  unsigned w;
+
+  if (snap.sn_dev != NO_DEV) return(EBUSY);
+  if (store == sp->s_dev) return(EINVAL);
+  bs = sp->s_block_size;
+  scale = sp->s_log_zone_size;
+  blocks = (block_t) sp->s_zones << scale;
+  if (blocks > SNAP_MAX_BLOCKS) return(EFBIG);
+
+  /* The store must be as large as the file system. */
+  if (dev_open(store, who, R_BIT|W_BIT) != OK) return(EINVAL);
+  if (dev_io(DEV_READ, store, FS_PROC_NR, snap_buf, (off_t) (blocks-1) * bs,
+							bs, 0) != bs) {
+	dev_close(store);
+	return(ENOSPC);
+  }
+
+  /* From here on, the file system on the disk is the snapshot. */
+  (void) do_sync();
+  invalidate(store);
+
+  /* Blocks of free zones are not in the snapshot, and need no copy. */
+  memset((char *) snap_done, 0, sizeof(snap_done));
+  bp = NIL_BUF;
+  mapblock = 0;
+  for (z = sp->s_firstdatazone; z < sp->s_zones; z++) {
+	bit = (bit_t) z - (sp->s_firstdatazone - 1);
+	if (bp == NIL_BUF || bit / FS_BITS_PER_BLOCK(bs) != mapblock) {
+		put_block(bp, MAP_BLOCK);
+		mapblock = bit / FS_BITS_PER_BLOCK(bs);
+		bp = get_block(sp->s_dev,
+			START_BLOCK + sp->s_imap_blocks + mapblock, NORMAL);
+	}
+	w = (bit % FS_BITS_PER_BLOCK(bs)) / FS_BITCHUNK_BITS;
+	if (conv2(sp->s_native, (int) bp->b_bitmap[w])
+				& (1 << (unsigned) (bit % FS_BITCHUNK_BITS)))
+		continue;
+	for (b = (block_t) z << scale; b < (block_t) (z + 1) << scale; b++)
+		SNAP_SET(b);
+  }
+  put_block(bp, MAP_BLOCK);
+
+  /* The journal was emptied by the sync, and is not replayed from a store. */
+  for (b = sp->s_jstart; b < sp->s_jstart + sp->s_jblocks; b++) SNAP_SET(b);
+
+  snap.sn_dev = sp->s_dev;
+  snap.sn_store = store;
+  snap.sn_block_size = bs;
+  snap.sn_blocks = blocks;
+  return(OK);
+}
+
+/*===========================================================================*
+ *				snap_end				     *
+ *===========================================================================*/
+/* store device of the snapshot */
+PUBLIC int snap_end(Dev_t store)
+{
+/* Forget a snapshot. Its store must not be mounted. */
+
+  if (!snap_view(store)) return(EINVAL);
+  invalidate(store);
+  dev_close(store);
+  snap.sn_dev = NO_DEV;
+  snap.sn_store = NO_DEV;
+  return(OK);
+}
+
+/*===========================================================================*
+ *				snap_copy				     *
+ *===========================================================================*/
+/* device about to be written */
+/* byte offset of the write */
+/* bytes to be written */
+PUBLIC void snap_copy(Dev_t dev, off_t pos, unsigned bytes)
+{
+/* Blocks are about to be written. If a snapshot is kept of the device, save
+ * those that still hold what the snapshot needs. Runs of them are copied in
+ * one read and one write.
+ */
+  block_t b, end;
+  int bs, n, r;
+
+  if (dev != snap.sn_dev || dev == NO_DEV) return;
+  bs = snap.sn_block_size;
+  b = pos / bs;
+  end = (pos + bytes + bs - 1) / bs;
+  if (end > snap.sn_blocks) end = snap.sn_blocks;
+
+  while (b < end) {
+	if (SNAP_DONE(b)) {
+		b++;
+		continue;
+	}
+	for (n = 1; b + n < end && n < sizeof(snap_buf) / bs
+						&& !SNAP_DONE(b + n); n++) {}
+	r = dev_io(DEV_READ, dev, FS_PROC_NR, snap_buf, (off_t) b * bs,
+								n * bs, 0);
+	if (r == n * bs) r = dev_io(DEV_WRITE, snap.sn_store, FS_PROC_NR,
+				snap_buf, (off_t) b * bs, n * bs, 0);
+	if (r != n * bs) {
+		printf("fs: cannot save block %lu in snapshot on %d/%d\n", b,
+		    (snap.sn_store>>MAJOR)&BYTE, (snap.sn_store>>MINOR)&BYTE);
+	}
+	while (n-- > 0) {
+		SNAP_SET(b);
+		b++;
+	}
+  }
+}
+
+/*===========================================================================*
+ *				snap_dev				     *
+ *===========================================================================*/
+/* device to read from */
+/* byte offset of the read */
+PUBLIC dev_t snap_dev(Dev_t dev, off_t pos)
+{
+/* Return the device to read a block from. For a block of a store that was not
+ * saved there, that is the file system of the snapshot.
+ */
+  block_t b;
+
+  if (dev != snap.sn_store || dev == NO_DEV) return(dev);
+  b = pos / snap.sn_block_size;
+  if (b >= snap.sn_blocks || SNAP_DONE(b)) return(dev);
+  return(snap.sn_dev);
+}
+
+/*===========================================================================*
+ *				snap_busy				     *
+ *===========================================================================*/
+/* device to check */
+PUBLIC int snap_busy(Dev_t dev)
+{
+/* Tell whether a snapshot is kept of a device. It may not be unmounted. */
+  return(dev != NO_DEV && dev == snap.sn_dev);
+}
+
+/*===========================================================================*
+ *				snap_view				     *
+ *===========================================================================*/
+/* device to check */
+PUBLIC int snap_view(Dev_t dev)
+{
+/* Tell whether a device is the store of a snapshot. */
+  return(dev != NO_DEV && dev == snap.sn_store);
+}
@@ -6,13 +6,14 @@
  *   do_chroot:	perform the CHROOT system call
  *   do_stat:	perform the STAT system call
  *   do_fstat:	perform the FSTAT system call
- *   do_fstatfs: perform the FSTATFS system call
+ *   do_fstatfs: perform the FSTATFS and FSTATFS2 system calls
  */
 
 #include "fs.h"
 #include <sys/stat.h>
 #include <sys/statfs.h>
 #include <minix/com.h>
+#include <minix/callnr.h>
 #include "file.h"
 #include "fproc.h"
 #include "inode.h"
@@ -221,18 +222,36 @@ PRIVATE int stat_inode(register struct inode *rip, struct filp *fil_ptr, char *u
  *===========================================================================*/
 PUBLIC int do_fstatfs()
 {
-  /* Perform the fstatfs(fd, buf) system call. */
+  /* Perform the fstatfs(fd, buf) system call. FSTATFS copies f_bsize only,
+   * the struct as old programs know it; FSTATFS2 copies as much as the caller
+   * says it has room for.
+   */
   struct statfs st;
   register struct filp *rfilp;
+  register struct super_block *sp;
+  phys_bytes size;
   int r;
 
+  if (call_nr == FSTATFS) {
+	size = sizeof(st.f_bsize);
+  } else {
+	if (m_in.nbytes < 0) return(EINVAL);
+	size = sizeof(st);
+	if ((phys_bytes) m_in.nbytes < size) size = m_in.nbytes;
+  }
+
   /* Is the file descriptor valid? */
   if ( (rfilp = get_filp(m_in.fd)) == NIL_FILP) return(err_code);
 
-  st.f_bsize = rfilp->filp_ino->i_sp->s_block_size;
+  sp = rfilp->filp_ino->i_sp;
+  st.f_bsize = sp->s_block_size;
+  st.f_blocks = (long) sp->s_zones << sp->s_log_zone_size;
+  st.f_bfree = (long) sp->s_zfree << sp->s_log_zone_size;
+  st.f_files = sp->s_ninodes;
+  st.f_ffree = sp->s_ifree;
 
   r = sys_datacopy(FS_PROC_NR, (vir_bytes) &st,
-  		who, (vir_bytes) m_in.buffer, (phys_bytes) sizeof(st));
+  		who, (vir_bytes) m_in.buffer, size);
 
    return(r);
 }
\ No newline at end of file
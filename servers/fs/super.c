@@ -6,6 +6,7 @@
  * The entry points into this file are
  *   alloc_bit:       somebody wants to allocate a zone or inode; find one
  *   free_bit:        indicate that a zone or inode is available for allocation
+ *   count_free:      count the free zones and inodes of a new file system
  *   get_super:       search the 'superblock' table for a device
  *   mounted:         tells if file inode is on mounted (or ROOT) file system
  *   read_super:      read a superblock
@@ -19,6 +20,9 @@
 #include "super.h"
 #include "const.h"
 
+FORWARD _PROTOTYPE( bit_t map_free, (struct super_block *sp, int map)	);
+FORWARD _PROTOTYPE( unsigned popcount, (unsigned k)			);
+
 /*===========================================================================*
  *				alloc_bit				     *
  *===========================================================================*/
@@ -35,7 +39,7 @@ PUBLIC bit_t alloc_bit(struct super_block *sp, int map, bit_t origin)
   unsigned block, word, bcount;
   struct buf *bp;
   bitchunk_t *wptr, *wlim, k;
-  bit_t i, b;
+  bit_t i, b, *nfree;
 
   if (sp->s_rd_only)
 	  panic(__FILE__,"can't allocate bit on read-only filesys.", NO_NUM);
@@ -44,12 +48,17 @@ PUBLIC bit_t alloc_bit(struct super_block *sp, int map, bit_t origin)
     start_block = START_BLOCK;
     map_bits = sp->s_ninodes + 1;
     bit_blocks = sp->s_imap_blocks;
+    nfree = &sp->s_ifree;
   } else {
     start_block = START_BLOCK + sp->s_imap_blocks;
     map_bits = sp->s_zones - (sp->s_firstdatazone - 1);
     bit_blocks = sp->s_zmap_blocks;
+    nfree = &sp->s_zfree;
   }
 
+  /* A full map need not be searched to find that out. */
+  if (*nfree == 0) return(NO_BIT);
+
   /* Figure out where to start the bit search (depends on 'origin'). */
   if (origin >= map_bits) origin = 0;	/* for robustness */
 
@@ -86,6 +95,7 @@ PUBLIC bit_t alloc_bit(struct super_block *sp, int map, bit_t origin)
 		*wptr = conv2(sp->s_native, (int) k);
 		bp->b_dirt = DIRTY;
 		put_block(bp, MAP_BLOCK);
+		(*nfree)--;
 		return(b);
 	}
 	put_block(bp, MAP_BLOCK);
@@ -138,6 +148,88 @@ PUBLIC void free_bit(struct super_block *sp, int map, bit_t bit_returned)
   bp->b_dirt = DIRTY;
 
   put_block(bp, MAP_BLOCK);
+  if (map == IMAP) sp->s_ifree++; else sp->s_zfree++;
+}
+
+/*===========================================================================*
+ *				count_free				     *
+ *===========================================================================*/
+/* the filesystem just mounted */
+PUBLIC void count_free(struct super_block *sp)
+{
+/* Count the free inodes and zones of a file system that is being mounted, so
+ * that fstatfs() can tell them, and a full map is known without searching it.
+ * From here on alloc_bit() and free_bit() keep the counts up to date.
+ */
+  sp->s_ifree = map_free(sp, IMAP);
+  sp->s_zfree = map_free(sp, ZMAP);
+}
+
+/*===========================================================================*
+ *				map_free				     *
+ *===========================================================================*/
+/* the filesystem to count in */
+/* IMAP (inode map) or ZMAP (zone map) */
+PRIVATE bit_t map_free(struct super_block *sp, int map)
+{
+/* Return the number of bits not set in a bit map. Bits past the end of the
+ * map in its last block are not counted, whatever they are.
+ */
+  block_t start_block;
+  bit_t map_bits, b, used;
+  unsigned block, bit_blocks, k;
+  struct buf *bp;
+  bitchunk_t *wptr, *wlim;
+
+  if (map == IMAP) {
+    start_block = START_BLOCK;
+    map_bits = sp->s_ninodes + 1;
+    bit_blocks = sp->s_imap_blocks;
+  } else {
+    start_block = START_BLOCK + sp->s_imap_blocks;
+    map_bits = sp->s_zones - (sp->s_firstdatazone - 1);
+    bit_blocks = sp->s_zmap_blocks;
+  }
+
+  used = 0;
+  b = 0;
+  for (block = 0; block < bit_blocks && b < map_bits; block++) {
+	bp = get_block(sp->s_dev, start_block + block, NORMAL);
+	wlim = &bp->b_bitmap[FS_BITMAP_CHUNKS(sp->s_block_size)];
+	for (wptr = &bp->b_bitmap[0]; wptr < wlim && b < map_bits; wptr++) {
+		/* Byte order doesn't matter to a count, except in the last,
+		 * partly used word, where the bits must be in their place.
+		 */
+		k = (unsigned) *wptr;
+		if (map_bits - b < FS_BITCHUNK_BITS) {
+			k = conv2(sp->s_native, (int) k);
+			k &= (1 << (unsigned) (map_bits - b)) - 1;
+		}
+		if (k == (bitchunk_t) ~0) {
+			used += FS_BITCHUNK_BITS;
+		} else if (k != 0) {
+			used += popcount(k);
+		}
+		b += FS_BITCHUNK_BITS;
+	}
+	put_block(bp, MAP_BLOCK);
+  }
+  return(map_bits - used);
+}
+
+/*===========================================================================*
+ *				popcount				     *
+ *===========================================================================*/
+/* a bit map chunk */
+PRIVATE unsigned popcount(unsigned k)
+{
+/* Count the bits set in a 16-bit word, adding pairs, then nibbles, then bytes
+ * in parallel, instead of testing the bits one by one.
+ */
+  k = (k & 0x5555) + ((k >> 1) & 0x5555);
+  k = (k & 0x3333) + ((k >> 2) & 0x3333);
+  k = (k & 0x0F0F) + ((k >> 4) & 0x0F0F);
+  return((k & 0x00FF) + (k >> 8));
 }
 
 /*===========================================================================*
@@ -219,7 +311,7 @@ PUBLIC int read_super(register struct super_block *sp)
   dev = sp->s_dev;		/* save device (will be overwritten by copy) */
   if (dev == NO_DEV)
   	panic(__FILE__,"request for super_block of NO_DEV", NO_NUM);
-  r = dev_io(DEV_READ, dev, FS_PROC_NR,
+  r = dev_io(DEV_READ, snap_dev(dev, (off_t) SUPER_BLOCK_BYTES), FS_PROC_NR,
   	sbbuf, SUPER_BLOCK_BYTES, MIN_BLOCK_SIZE, 0);
   if (r != MIN_BLOCK_SIZE) {
   	return EINVAL;
@@ -264,6 +356,14 @@ PUBLIC int read_super(register struct super_block *sp)
    * Calculate some other numbers that depend on the version here too, to
    * hide some of the differences.
    */
+  /* Only V3 super blocks can tell where a journal is. Nothing is in it yet;
+   * journal_replay() sets up the rest when the file system is mounted.
+   */
+  if (version != V3) sp->s_jblocks = 0;
+  sp->s_jcount = 0;
+  sp->s_flags = 0;
+  sp->s_rd_only = FALSE;		/* do_mount() says otherwise */
+
   if (version == V1) {
   	sp->s_block_size = STATIC_BLOCK_SIZE;
     sp->s_zones = sp->s_nzones;	/* only V1 needs this copy */
@@ -283,9 +383,15 @@ PUBLIC int read_super(register struct super_block *sp)
   if (sp->s_block_size < MIN_BLOCK_SIZE) {
   	return EINVAL;
   }
-  if (sp->s_block_size > MAX_BLOCK_SIZE) {
+  if (sp->s_block_size > MAX_LARGE_BLOCK_SIZE) {
   	printf("Filesystem block size is %d kB; maximum filesystem\n"
- 	"block size is %d kB. This limit can be increased by recompiling.\n",
+ 	"block size is %d kB.\n",
+  	sp->s_block_size/1024, MAX_LARGE_BLOCK_SIZE/1024);
+  	return EINVAL;
+  }
+  if (sp->s_block_size > MAX_BLOCK_SIZE && NR_LBUFS < 6) {
+  	printf("Filesystem block size is %d kB; blocks over %d kB need\n"
+ 	"NR_LBUFS large buffers. This can be changed by recompiling.\n",
   	sp->s_block_size/1024, MAX_BLOCK_SIZE/1024);
   	return EINVAL;
   }
@@ -15,6 +15,9 @@
  *    unused        whatever is needed to fill out the current zone
  *    data zones    (s_zones - s_firstdatazone) << s_log_zone_size
  *
+ * A V3 file system may have a metadata journal. It occupies s_jblocks blocks
+ * from s_jstart on, in zones that are marked as used in the zone bit map.
+ *
  * A super_block slot is free if s_dev == NO_DEV. 
  */
 
@@ -34,11 +37,14 @@ EXTERN struct super_block {
 
   /* The block size in bytes. Minimum MIN_BLOCK SIZE. SECTOR_SIZE
    * multiple. If V1 or V2 filesystem, this should be
-   * initialised to STATIC_BLOCK_SIZE. Maximum MAX_BLOCK_SIZE.
+   * initialised to STATIC_BLOCK_SIZE. Maximum MAX_LARGE_BLOCK_SIZE.
    */
   short s_pad2;			/* try to avoid compiler-dependent padding */
   unsigned short s_block_size;	/* block size in bytes. */
   char s_disk_version;		/* filesystem format sub-version */
+  char s_pad3;			/* try to avoid compiler-dependent padding */
+  block_t s_jstart;		/* first block of the journal */
+  block_t s_jblocks;		/* blocks in the journal, 0 if none */
 
   /* The following items are only used when the super_block is in memory. */
   struct inode *s_isup;		/* inode for root dir of mounted file sys */
@@ -46,12 +52,28 @@ EXTERN struct super_block {
   unsigned s_inodes_per_block;	/* precalculated from magic number */
   dev_t s_dev;			/* whose super block is this? */
   int s_rd_only;		/* set to 1 iff file sys mounted read only */
+  int s_flags;			/* MS_NOATIME, MS_RELATIME, ..., MS_INLINE */
+  int s_discard;		/* device takes MIOCDISCARD for freed zones */
+  int s_direct;			/* byte addressable device: file data goes
+				 * straight to it with dev_io() */
   int s_native;			/* set to 1 iff not byte swapped file system */
   int s_version;		/* file system version, zero means bad magic */
   int s_ndzones;		/* # direct zones in an inode */
   int s_nindirs;		/* # indirect zones per indirect block */
   bit_t s_isearch;		/* inodes below this bit number are in use */
   bit_t s_zsearch;		/* all zones below this bit number are in use*/
+  bit_t s_ifree;		/* number of free inodes */
+  bit_t s_zfree;		/* number of free zones */
+
+  /* The state of the metadata journal, if there is one. */
+  block_t s_jnext;		/* where the next transaction goes */
+  u32_t s_jseq;			/* its sequence number */
+  int s_jcount;			/* number of blocks in the open transaction */
+  int s_jdata;			/* journal holds directory or indirect blocks */
+  int s_jnrevoke;		/* blocks revoked by the open transaction */
+  unsigned s_jrevokes;		/* blocks revoked since the checkpoint */
+  struct buf *s_jbuf[JTRANS_MAX];	/* the open transaction */
+  block_t s_jrevoke[JREVOKE_MAX];	/* the blocks it revokes */
 } super_block[NR_SUPERS];
 
 #define NIL_SUPER (struct super_block *) 0
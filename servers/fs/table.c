@@ -108,6 +108,7 @@ PUBLIC _PROTOTYPE (int (*call_vec[]), (void) ) = {
 	no_sys,		/* 88 = getpriority */
 	no_sys,		/* 89 = setpriority */
 	no_sys,		/* 90 = gettimeofday */
+	do_fstatfs,	/* 91 = fstatfs2 */
 };
 /* This should not fail with "array size is negative": */
 extern int dummy[sizeof(call_vec) == NCALLS * sizeof(call_vec[0]) ? 1 : -1];
\ No newline at end of file
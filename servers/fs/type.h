@@ -21,3 +21,21 @@ typedef struct {		/* V2.x disk inode */
   time_t d2_ctime;		/* when was inode data last changed */
   zone_t d2_zone[V2_NR_TZONES];	/* block nums for direct, ind, and dbl ind */
 } d2_inode;
+
+/* Header of the metadata journal as it is on the disk. */
+typedef struct {
+  u32_t jh_magic;		/* JH_MAGIC */
+  u32_t jh_seq;			/* sequence number of first transaction */
+  u32_t jh_start;		/* its block, counted from the header */
+} jheader_t;
+
+/* Descriptor and commit block of a transaction in the journal. */
+typedef struct {
+  u32_t jd_magic;		/* JD_MAGIC or JC_MAGIC */
+  u32_t jd_seq;			/* sequence number of the transaction */
+  u32_t jd_count;		/* number of blocks in it */
+  u32_t jd_sum;			/* commit: checksum of descriptor and blocks */
+  block_t jd_block[JTRANS_MAX];	/* descriptor: where the blocks belong */
+  u32_t jd_nrevoke;		/* descriptor: number of blocks revoked */
+  block_t jd_revoke[JREVOKE_MAX];	/* blocks not to replay from before */
+} jdesc_t;
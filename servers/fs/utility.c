@@ -28,14 +28,16 @@ PUBLIC time_t clock_time()
 {
 /* This routine returns the time in seconds since 1.1.1970.  MINIX is an
  * astrophysically naive system that assumes the earth rotates at a constant
- * rate and that such things as leap seconds do not exist.
+ * rate and that such things as leap seconds do not exist. The time is kept
+ * in fs_time for those who can do with a recent one.
  */
 
   register int k;
   clock_t uptime;
 
   if ( (k=getuptime(&uptime)) != OK) panic(__FILE__,"clock_time err", k);
-  return( (time_t) (boottime + (uptime/HZ)));
+  fs_time = (time_t) (boottime + (uptime/HZ));
+  return(fs_time);
 }
 
 /*===========================================================================*
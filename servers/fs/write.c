@@ -5,6 +5,7 @@
  *   do_write:     call read_write to perform the WRITE system call
  *   clear_zone:   erase a zone in the middle of a file
  *   new_block:    acquire a new block
+ *   uninline:     move the data of an inline file to a block
  */
 
 #include "fs.h"
@@ -101,7 +102,10 @@ PRIVATE int write_map(register struct inode *rip, off_t position, zone_t new_zon
 		wr_indir(bp, ind_ex, z1);	/* update dbl indir */
 
 	new_ind = TRUE;
-	if (bp != NIL_BUF) bp->b_dirt = DIRTY;	/* if double ind, it is dirty*/
+	if (bp != NIL_BUF) {			/* if double ind, it is dirty*/
+		bp->b_dirt = DIRTY;
+		bp->b_ino = rip->i_num;
+	}
 	if (z1 == NO_ZONE) {
 		put_block(bp, INDIRECT_BLOCK);	/* release dbl indirect blk */
 		return(err_code);	/* couldn't create single ind */
@@ -116,6 +120,7 @@ PRIVATE int write_map(register struct inode *rip, off_t position, zone_t new_zon
   ex = (int) excess;			/* we need an int here */
   wr_indir(bp, ex, new_zone);
   bp->b_dirt = DIRTY;
+  bp->b_ino = rip->i_num;
   put_block(bp, INDIRECT_BLOCK);
 
   return(OK);
@@ -178,6 +183,7 @@ PUBLIC void clear_zone(register struct inode *rip, off_t pos, int flag)
   for (b = blo; b <= bhi; b++) {
 	bp = get_block(rip->i_dev, b, NO_READ);
 	zero_block(bp);
+	bp->b_ino = rip->i_num;
 	put_block(bp, FULL_DATA_BLOCK);
   }
 }
@@ -189,12 +195,32 @@ PUBLIC void clear_zone(register struct inode *rip, off_t pos, int flag)
 /* file pointer */
 PUBLIC struct buf *new_block(register struct inode *rip, off_t position)
 {
-/* Acquire a new block and return a pointer to it.  Doing so may require
- * allocating a complete zone, and then returning the initial block.
- * On the other hand, the current zone may still have some unused blocks.
- */
+/* Acquire a new block and return a pointer to it. */
 
   register struct buf *bp;
+  block_t b;
+
+  if ( (b = alloc_block(rip, position)) == NO_BLOCK) return(NIL_BUF);
+  bp = get_block(rip->i_dev, b, NO_READ);
+  zero_block(bp);
+  bp->b_ino = rip->i_num;
+  return(bp);
+}
+
+/*===========================================================================*
+ *				alloc_block				     *
+ *===========================================================================*/
+/* pointer to inode */
+/* file pointer */
+PUBLIC block_t alloc_block(register struct inode *rip, off_t position)
+{
+/* Return the block for 'position' in a file, allocating it if need be. Doing
+ * so may require allocating a complete zone, and then returning the initial
+ * block. On the other hand, the current zone may still have some unused
+ * blocks. The block is not fetched. On failure NO_BLOCK is returned, with
+ * the reason in 'err_code'.
+ */
+
   block_t b, base_block;
   zone_t z;
   zone_t zone_size;
@@ -214,11 +240,11 @@ PUBLIC struct buf *new_block(register struct inode *rip, off_t position)
     } else {
       z = rip->i_zone[0];	/* hunt near first zone */
     }
-    if ( (z = alloc_zone(rip->i_dev, z)) == NO_ZONE) return(NIL_BUF);
+    if ( (z = alloc_zone(rip->i_dev, z)) == NO_ZONE) return(NO_BLOCK);
     if ( (r = write_map(rip, position, z)) != OK) {
       free_zone(rip->i_dev, z);
       err_code = r;
-      return(NIL_BUF);
+      return(NO_BLOCK);
     }
 
     /* If we are not writing at EOF, clear the zone, just to be safe. */
@@ -228,10 +254,7 @@ PUBLIC struct buf *new_block(register struct inode *rip, off_t position)
     zone_size = (zone_t) rip->i_sp->s_block_size << scale;
     b = base_block + (block_t)((position % zone_size)/rip->i_sp->s_block_size);
   }
-
-  bp = get_block(rip->i_dev, b, NO_READ);
-  zero_block(bp);
-  return(bp);
+  return(b);
 }
 
 /*===========================================================================*
@@ -241,6 +264,35 @@ PUBLIC struct buf *new_block(register struct inode *rip, off_t position)
 PUBLIC void zero_block(register struct buf *bp)
 {
 /* Zero a block. */
-  memset(bp->b_data, 0, MAX_BLOCK_SIZE);
+  memset(bp->b_data, 0, bp->b_bytes);
   bp->b_dirt = DIRTY;
 }
+
+/*===========================================================================*
+ *				uninline				     *
+ *===========================================================================*/
+/* inline file about to grow */
+PUBLIC int uninline(register struct inode *rip)
+{
+/* Move the data of an inline file to a block of its own, so that the file can
+ * grow past INLINE_MAX bytes.
+ */
+  char data[INLINE_MAX];
+  struct buf *bp;
+
+  memcpy(data, (char *) rip->i_zone, INLINE_MAX);
+  memset((char *) rip->i_zone, 0, INLINE_MAX);	/* all NO_ZONE */
+  rip->i_inline = FALSE;
+  rip->i_dirt = DIRTY;
+  if (rip->i_size == 0) return(OK);
+
+  if ((bp = new_block(rip, (off_t) 0)) == NIL_BUF) {
+	/* No room on the device; the file stays as it was. */
+	memcpy((char *) rip->i_zone, data, INLINE_MAX);
+	rip->i_inline = TRUE;
+	return(err_code);
+  }
+  memcpy(bp->b_data, data, (size_t) rip->i_size);
+  put_block(bp, PARTIAL_DATA_BLOCK);	/* new_block() made it dirty */
+  return(OK);
+}
@@ -0,0 +1,175 @@
+/* ramzip - compress a RAM disk image		Usage: ramzip image zimage
+ *
+ * Makes a compressed RAM disk image, in the format of <minix/ramzip.h>, that
+ * FS decompresses when it loads the RAM disk. Every frame is compressed in
+ * the LZ4 block format, with a simple greedy match search; a frame that does
+ * not get smaller is stored as it is.
+ */
+
+#include <sys/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <minix/ramzip.h>
+
+#define FRAME		32768	/* image bytes per frame */
+#define HASH_BITS	12
+#define HASH(p)	((((p)[0] | (p)[1] << 8 | (long) (p)[2] << 16 | \
+		(long) (p)[3] << 24) * 2654435761UL) >> (32 - HASH_BITS) \
+		& ((1 << HASH_BITS) - 1))
+
+unsigned char frame[FRAME];
+unsigned char cframe[RZ_CFRAME_MAX];
+int hash[1 << HASH_BITS];		/* position + 1 of a 4-byte string */
+
+_PROTOTYPE( int main, (int argc, char **argv)				);
+_PROTOTYPE( int lz4, (unsigned char *src, int n, unsigned char *dst)	);
+_PROTOTYPE( unsigned char *sequence, (unsigned char *op,
+		unsigned char *lit, int nlit, int off, int mlen)	);
+_PROTOTYPE( unsigned char *length, (unsigned char *op, int n)		);
+_PROTOTYPE( void put32, (unsigned char *p, unsigned long v)		);
+_PROTOTYPE( void fatal, (char *what)					);
+
+int main(argc, argv)
+int argc;
+char **argv;
+{
+  FILE *in, *out;
+  unsigned char hdr[RZ_HDR_SIZE], len[4];
+  unsigned long size, wrote;
+  int n, c;
+
+  if (argc != 3) {
+	fprintf(stderr, "Usage: ramzip image zimage\n");
+	exit(1);
+  }
+  if ((in = fopen(argv[1], "rb")) == NULL) fatal(argv[1]);
+  if ((out = fopen(argv[2], "wb")) == NULL) fatal(argv[2]);
+
+  /* The header has the size, and a copy of the super block. */
+  if (fseek(in, 0L, SEEK_END) != 0 || (long) (size = ftell(in)) < 0)
+	fatal(argv[1]);
+  memset(hdr, 0, sizeof(hdr));
+  memcpy(hdr, RZ_MAGIC, RZ_MAGIC_LEN);
+  put32(hdr + RZ_SIZE_OFF, size);
+  put32(hdr + RZ_FRAME_OFF, (unsigned long) FRAME);
+  if (fseek(in, 1024L, SEEK_SET) != 0) fatal(argv[1]);
+  (void) fread(hdr + 1024, 1, 1024, in);
+  if (fseek(in, 0L, SEEK_SET) != 0) fatal(argv[1]);
+  if (fwrite(hdr, 1, sizeof(hdr), out) != sizeof(hdr)) fatal(argv[2]);
+  wrote = sizeof(hdr);
+
+  /* The frames. */
+  while ((n = fread(frame, 1, FRAME, in)) > 0) {
+	if ((c = lz4(frame, n, cframe)) < n) {
+		put32(len, (unsigned long) c);
+		if (fwrite(len, 1, 4, out) != 4
+			|| fwrite(cframe, 1, c, out) != c) fatal(argv[2]);
+	} else {
+		put32(len, (unsigned long) n | RZ_STORED);
+		if (fwrite(len, 1, 4, out) != 4
+			|| fwrite(frame, 1, n, out) != n) fatal(argv[2]);
+		c = n;
+	}
+	wrote += 4 + c;
+  }
+  if (ferror(in)) fatal(argv[1]);
+
+  /* Pad, so that the last block can be read. */
+  while (wrote % RZ_ALIGN != 0) {
+	if (putc(0, out) == EOF) fatal(argv[2]);
+	wrote++;
+  }
+  if (fclose(out) == EOF) fatal(argv[2]);
+  printf("%s: %lu bytes in %lu bytes\n", argv[2], size, wrote);
+  return(0);
+}
+
+int lz4(src, n, dst)
+unsigned char *src;
+int n;
+unsigned char *dst;
+{
+/* Compress 'n' bytes in the LZ4 block format, return the compressed size.
+ * As the format wants, the last match ends 5 bytes before the end at the
+ * latest, and starts 12 bytes before it.
+ */
+  unsigned char *op;
+  int i, ref, mlen, anchor;
+  unsigned h;
+
+  memset(hash, 0, sizeof(hash));
+  op = dst;
+  anchor = 0;
+  i = 0;
+  while (i < n - 12) {
+	h = HASH(src + i);
+	ref = hash[h] - 1;
+	hash[h] = i + 1;
+	if (ref < 0 || i - ref > 65535 || memcmp(src + ref, src + i, 4) != 0) {
+		i++;
+		continue;
+	}
+	for (mlen = 4; i + mlen < n - 5 && src[ref + mlen] == src[i + mlen];
+								mlen++) {}
+	op = sequence(op, src + anchor, i - anchor, i - ref, mlen);
+	i += mlen;
+	anchor = i;
+  }
+  op = sequence(op, src + anchor, n - anchor, 0, 0);
+  return(op - dst);
+}
+
+unsigned char *sequence(op, lit, nlit, off, mlen)
+unsigned char *op;
+unsigned char *lit;
+int nlit;
+int off;
+int mlen;
+{
+/* Add a sequence: literals, then a match unless 'mlen' is 0. */
+  int mcode;
+
+  mcode = mlen == 0 ? 0 : mlen - 4;
+  *op++ = (nlit < 15 ? nlit : 15) << 4 | (mcode < 15 ? mcode : 15);
+  if (nlit >= 15) op = length(op, nlit - 15);
+  memcpy(op, lit, nlit);
+  op += nlit;
+  if (mlen != 0) {
+	*op++ = off & 0xFF;
+	*op++ = off >> 8;
+	if (mcode >= 15) op = length(op, mcode - 15);
+  }
+  return(op);
+}
+
+unsigned char *length(op, n)
+unsigned char *op;
+int n;
+{
+/* Add the rest of a long length, in bytes of 255 and a last smaller one. */
+  while (n >= 255) {
+	*op++ = 255;
+	n -= 255;
+  }
+  *op++ = n;
+  return(op);
+}
+
+void put32(p, v)
+unsigned char *p;
+unsigned long v;
+{
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+void fatal(what)
+char *what;
+{
+  fprintf(stderr, "ramzip: ");
+  perror(what);
+  exit(1);
+}